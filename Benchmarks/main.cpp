@@ -0,0 +1,118 @@
+// Micro benchmarks of the Core threading primitives, run with a Release build.
+//
+//   Benchmarks [messages] [objects]
+//
+// queue:  one producer and one consumer thread pass `messages` (default 10M) values
+//         through Core::Queue (mutex + condition variable) and Core::SpscQueue.
+// jobs:   JobSystem::ParallelFor over `objects` (default 100k) transforms, the work of
+//         GameLoop's render list extraction, from 1 thread up to all hardware threads.
+
+#include "Core/Base.h"
+#include "Core/Clock.h"
+#include "Core/JobSystem.h"
+#include "Core/Queue.h"
+#include "Core/RenderList.h"
+#include "Core/SpscQueue.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace Core;
+
+constexpr u32 RUNS = 5;
+
+// Best of RUNS, in milliseconds
+template<typename Func>
+static double measure(Func&& func)
+{
+    double best = 1e300;
+    for (u32 run = 0; run < RUNS; ++run)
+    {
+        u64 start = Clock::nanos();
+        func();
+        best = std::min(best, (Clock::nanos() - start) / 1e6);
+    }
+    return best;
+}
+
+template<typename QueueType>
+static double queueBenchmark(u64 messages)
+{
+    return measure([messages] {
+        QueueType queue;
+        u64 sum = 0;
+
+        std::thread consumer([&queue, &sum, messages] {
+            u64 value;
+            for (u64 i = 0; i < messages; ++i)
+            {
+                queue.receive(value);
+                sum += value;
+            }
+        });
+
+        for (u64 i = 0; i < messages; ++i) queue.send(i);
+        consumer.join();
+
+        if (sum != messages * (messages - 1) / 2) std::printf("  lost messages!\n");
+    });
+}
+
+static void queueBenchmarks(u64 messages)
+{
+    std::printf("queue: %llu messages, 1 producer, 1 consumer\n", (unsigned long long)messages);
+
+    double locked = queueBenchmark<Queue<u64>>(messages);
+    double spsc = queueBenchmark<SpscQueue<u64>>(messages);
+
+    std::printf("  %-12s %9.1f ms %8.1f M/s\n", "Queue", locked, messages / locked / 1e3);
+    std::printf("  %-12s %9.1f ms %8.1f M/s  %.1fx\n", "SpscQueue", spsc, messages / spsc / 1e3, locked / spsc);
+}
+
+static void jobBenchmarks(u32 objects)
+{
+    u32 threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::printf("jobs: %u objects, 1 to %u threads\n", objects, threads);
+
+    std::vector<Transform> transforms(objects);
+    for (u32 i = 0; i < objects; ++i)
+    {
+        transforms[i].location = { (float)i, 0.0f, 0.0f };
+        transforms[i].rotation = { (float)(i % 360), (float)(i % 180), 0.0f };
+    }
+    std::vector<Mat4f> matrices(objects);
+
+    // The calling thread runs jobs too while it waits, so N threads are N - 1 workers
+    double single = 0.0;
+    for (u32 count = 1; count <= threads; ++count)
+    {
+        JobSystem::Start(count - 1);
+
+        double ms = measure([&] {
+            JobSystem::ParallelFor(objects, 256, [&](u32 i) {
+                transforms[i].rotation.yaw += 1.0f;
+                matrices[i] = WorldMatrix(transforms[i]);
+            });
+        });
+
+        JobSystem::Stop();
+
+        if (count == 1) single = ms;
+        std::printf("  %2u threads %9.3f ms  %.2fx\n", count, ms, single / ms);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Clock::Calibrate();
+
+    u64 messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+    u32 objects = argc > 2 ? (u32)std::strtoul(argv[2], nullptr, 10) : 100'000;
+
+    queueBenchmarks(std::max<u64>(messages, 1));
+    jobBenchmarks(std::max(objects, 1u));
+    return 0;
+}
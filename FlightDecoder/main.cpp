@@ -0,0 +1,189 @@
+// Prints the log kept in a flight recorder file (Negroni.flight, Negroni.flight.prev).
+//
+//   FlightDecoder <file> [-v]
+//
+// -v adds the thread and the source file and line of every record.
+
+#include "Core/FlightRecorder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <string>
+#include <variant>
+#include <vector>
+
+using namespace Core;
+
+typedef std::variant<int64_t, uint64_t, double, bool, char, const void*, std::string_view> Value;
+
+static const char* levelName(uint32_t level)
+{
+    static const char* names[] = { "Debug", "Info", "Warn", "Error" };
+    return level < std::size(names) ? names[level] : "?";
+}
+
+template<typename T>
+static T read(const char*& cursor)
+{
+    T value;
+    memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return value;
+}
+
+static std::vector<Value> readArgs(const FlightSlot& slot)
+{
+    std::vector<Value> args;
+    const char* cursor = slot.payload;
+    const char* end = slot.payload + std::min<size_t>(slot.size, sizeof(slot.payload));
+
+    for (uint32_t i = 0; i < slot.argCount && cursor < end; ++i)
+    {
+        switch ((FlightArg)*cursor++)
+        {
+        case FlightArg::Int:     args.push_back(read<int64_t>(cursor)); break;
+        case FlightArg::UInt:    args.push_back(read<uint64_t>(cursor)); break;
+        case FlightArg::Float:   args.push_back(read<double>(cursor)); break;
+        case FlightArg::Bool:    args.push_back(read<bool>(cursor)); break;
+        case FlightArg::Char:    args.push_back(read<char>(cursor)); break;
+        case FlightArg::Pointer: args.push_back((const void*)(uintptr_t)read<uint64_t>(cursor)); break;
+        case FlightArg::String:
+        {
+            uint16_t length = read<uint16_t>(cursor);
+            length = (uint16_t)std::min<size_t>(length, end - cursor);
+            args.push_back(std::string_view(cursor, length));
+            cursor += length;
+            break;
+        }
+        default:
+            return args;
+        }
+    }
+
+    return args;
+}
+
+static void formatValue(std::string& out, const Value& value, std::string_view spec)
+{
+    std::string format = spec.empty() ? "{}" : std::format("{{:{}}}", spec);
+    std::visit([&](const auto& arg) {
+        try
+        {
+            std::vformat_to(std::back_inserter(out), format, std::make_format_args(arg));
+        }
+        catch (const std::format_error&)
+        {
+            // The spec was meant for the original type, e.g. a vector stored as text
+            std::format_to(std::back_inserter(out), "{}", arg);
+        }
+    }, value);
+}
+
+// std::format with the types known only at run time
+static std::string formatMessage(std::string_view format, const std::vector<Value>& args, bool truncated)
+{
+    std::string out;
+    size_t nextArg = 0;
+
+    for (size_t i = 0; i < format.size(); ++i)
+    {
+        char c = format[i];
+        if ((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c)
+        {
+            out += c;
+            ++i;
+            continue;
+        }
+        if (c != '{')
+        {
+            out += c;
+            continue;
+        }
+
+        size_t close = format.find('}', i);
+        if (close == std::string_view::npos)
+        {
+            out += format.substr(i);
+            break;
+        }
+
+        std::string_view field = format.substr(i + 1, close - i - 1);
+        size_t colon = field.find(':');
+        std::string_view index = field.substr(0, colon);
+        std::string_view spec = colon == std::string_view::npos ? std::string_view() : field.substr(colon + 1);
+
+        size_t arg = index.empty() ? nextArg++ : (size_t)std::atoi(std::string(index).c_str());
+        if (arg < args.size()) formatValue(out, args[arg], spec);
+        else out += "{?}";
+
+        i = close;
+    }
+
+    if (truncated) out += " [truncated]";
+    return out;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::printf("Usage: FlightDecoder <file> [-v]\n");
+        return 1;
+    }
+    bool verbose = argc > 2 && std::strcmp(argv[2], "-v") == 0;
+
+    std::ifstream file(argv[1], std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < FLIGHT_FILE_SIZE || memcmp(data.data(), FLIGHT_MAGIC, sizeof(FLIGHT_MAGIC)) != 0)
+    {
+        std::printf("%s is not a flight recorder file\n", argv[1]);
+        return 1;
+    }
+
+    const FlightHeader& header = *(const FlightHeader*)data.data();
+    if (header.slotSize != FLIGHT_SLOT_SIZE || header.slotCount != FLIGHT_SLOT_COUNT || header.maxSites != FLIGHT_MAX_SITES)
+    {
+        std::printf("%s was written by a different version\n", argv[1]);
+        return 1;
+    }
+
+    const FlightSite* sites = (const FlightSite*)(data.data() + FLIGHT_SITES_OFFSET);
+    const FlightSlot* slots = (const FlightSlot*)(data.data() + FLIGHT_SLOTS_OFFSET);
+    uint32_t siteCount = std::min(header.siteCount.load(), FLIGHT_MAX_SITES);
+
+    // Slots that were being written when the process died still read 0
+    std::vector<const FlightSlot*> records;
+    for (uint32_t i = 0; i < FLIGHT_SLOT_COUNT; ++i)
+    {
+        const FlightSlot& slot = slots[i];
+        if (slot.sequence.load() != 0 && slot.site != 0 && slot.site <= siteCount) records.push_back(&slot);
+    }
+    std::sort(records.begin(), records.end(), [](const FlightSlot* a, const FlightSlot* b) { return a->sequence.load() < b->sequence.load(); });
+
+    uint64_t written = header.next.load();
+    if (written > records.size())
+    {
+        std::printf("(%llu earlier records were overwritten)\n", (unsigned long long)(written - records.size()));
+    }
+
+    for (const FlightSlot* slot : records)
+    {
+        const FlightSite& site = sites[slot->site - 1];
+        std::string message = formatMessage(site.format, readArgs(*slot), slot->truncated);
+        double seconds = (slot->timestamp - header.startNanos) / 1e9;
+
+        if (verbose)
+        {
+            std::printf("%12.6f T%-3u [%s] %s %s (%s:%u)\n", seconds, slot->thread, site.location, levelName(site.level), message.c_str(), site.file, site.line);
+        }
+        else
+        {
+            std::printf("%12.6f [%s] %s %s\n", seconds, site.location, levelName(site.level), message.c_str());
+        }
+    }
+
+    return 0;
+}
@@ -80,8 +80,6 @@ MeshRef Assimp::AssimpMeshLoader::LoadMesh(str fileName)
 	mesh->boundingSphere.radius = calculateBoundingRadius();
 	resetBoundingBox();
 
-	log_info("vertices read {}", mesh->vertices.size());
-
 	for (u32 i = 0; i < rawMesh->mNumFaces; i++)
 	{
 		aiFace face = rawMesh->mFaces[i];
@@ -92,9 +90,8 @@ MeshRef Assimp::AssimpMeshLoader::LoadMesh(str fileName)
 		}
 	}
 
-	log_info("indices read {}", mesh->indices.size());
-	log_info("bounding sphere center {}", mesh->boundingSphere.center);
-	log_info("bounding sphere radius {}", mesh->boundingSphere.radius);
+	LOG_THROTTLED(LogLevel::Info, 20, "read {} vertices, {} indices, bounding sphere center {} radius {}",
+		mesh->vertices.size(), mesh->indices.size(), mesh->boundingSphere.center, mesh->boundingSphere.radius);
 
 	return mesh;
 }
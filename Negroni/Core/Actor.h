@@ -0,0 +1,123 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "MpmcQueue.h"
+
+#include <atomic>
+#include <cassert>
+#include <deque>
+
+namespace Core
+{
+    // Lightweight alternative to Thread: a mailbox without a thread of its own.
+    // When a message arrives the actor is scheduled as a job on the JobSystem workers,
+    // which run at most `throughput` messages before handing the worker to other actors.
+    // Messages of one actor are always executed one at a time and in order, so
+    // execute() needs no locking, and hundreds of actors share a fixed set of threads.
+    //
+    // Derived classes must call stop() in their destructor so no message is
+    // executed on a partially destroyed object, ~Actor() runs too late for that and only checks it.
+    template<typename MessageType, std::size_t MailboxSize = 256>
+    class Actor
+    {
+    public:
+        explicit Actor(u32 throughput = 64) : throughput(throughput) {}
+
+        virtual ~Actor()
+        {
+            assert(mailbox.empty() && overflow.empty() && pending.Done() && !scheduled.load() && "stop() the actor in the derived destructor");
+        }
+
+        // Can be called from any thread. Blocks while the mailbox is full, except when the
+        // actor sends to itself: nobody else would empty the mailbox, so it waits in overflow.
+        void send(MessageType& message)
+        {
+            if (current == this)
+            {
+                if (!overflow.empty() || !mailbox.trySend(message)) overflow.push_back(message);
+            }
+            else
+            {
+                mailbox.send(message);
+            }
+            Schedule();
+        }
+
+        // Waits until every message sent so far has been executed
+        void stop()
+        {
+            while (!mailbox.empty() || !pending.Done())
+            {
+                JobSystem::Wait(pending);
+                if (!mailbox.empty()) Schedule();
+            }
+        }
+
+        size_t size() const
+        {
+            return mailbox.size();
+        }
+
+        virtual void execute(MessageType& message) = 0;
+
+    private:
+        void Schedule()
+        {
+            if (scheduled.exchange(true, std::memory_order_seq_cst)) return;
+
+            if (JobSystem::WorkerCount() == 0)
+            {
+                // Nobody to hand the actor to, run it on the sending thread
+                pending.value.fetch_add(1, std::memory_order_relaxed);
+                Turn(this, 0, 0);
+                return;
+            }
+
+            JobSystem::Run(Job{ Turn, this, 0, 0, &pending });
+        }
+
+        static void Turn(void* data, u32, u32)
+        {
+            Actor* self = (Actor*)data;
+
+            // Without workers, actors sending to each other nest their turns on one thread
+            Actor* outer = current;
+            current = self;
+
+            MessageType message;
+            for (u32 i = 0; i < self->throughput && self->mailbox.tryReceive(message); ++i)
+            {
+                self->execute(message);
+            }
+
+            // Self sends that did not fit, in order, as far as the mailbox has room now
+            while (!self->overflow.empty() && self->mailbox.trySend(self->overflow.front()))
+            {
+                self->overflow.pop_front();
+            }
+
+            current = outer;
+
+            // Only touched during a turn, read before another one can start
+            bool overflowed = !self->overflow.empty();
+
+            self->scheduled.store(false, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // A sender may have seen the actor as scheduled after the loop above gave up
+            bool reschedule = overflowed || !self->mailbox.empty();
+            if (JobSystem::WorkerCount() == 0)
+                self->pending.value.fetch_sub(1, std::memory_order_release);
+            if (reschedule) self->Schedule();
+        }
+
+        // The actor whose turn runs on this thread
+        inline static thread_local Actor* current = nullptr;
+
+        MpmcQueue<MessageType, MailboxSize> mailbox;
+        std::deque<MessageType> overflow;
+        std::atomic<bool> scheduled = false;
+        JobCounter pending;
+        u32 throughput;
+    };
+}
@@ -0,0 +1,193 @@
+#include "AllocationTracker.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace Core
+{
+#ifdef ALLOCATION_TRACKING
+    // Fixed tables of atomics, the hooks below must not allocate
+    struct SiteAllocations
+    {
+        std::atomic<const ProfileSite*> site = nullptr;
+        std::atomic<u64> count = 0;
+        std::atomic<u64> bytes = 0;
+    };
+
+    static SiteAllocations siteAllocations[ALLOCATION_MAX_SITES];
+    static SiteAllocations unscoped;
+    static std::atomic<u64> allocationCount = 0;
+    static std::atomic<u64> allocationBytes = 0;
+    static std::atomic<u64> freeCount = 0;
+
+    static SiteAllocations* FindSite(const ProfileSite* site)
+    {
+        if (!site) return &unscoped;
+
+        u32 index = (u32)(((uintptr_t)site >> 4) * 2654435761u) & (ALLOCATION_MAX_SITES - 1);
+        for (u32 probe = 0; probe < ALLOCATION_MAX_SITES; ++probe, index = (index + 1) & (ALLOCATION_MAX_SITES - 1))
+        {
+            SiteAllocations& entry = siteAllocations[index];
+            const ProfileSite* current = entry.site.load(std::memory_order_acquire);
+            if (current == site) return &entry;
+            if (current == nullptr)
+            {
+                if (entry.site.compare_exchange_strong(current, site, std::memory_order_acq_rel) || current == site) return &entry;
+            }
+        }
+
+        // Table is full, charge it to no scope
+        return &unscoped;
+    }
+
+    static void RecordAllocation(size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add(size, std::memory_order_relaxed);
+
+        SiteAllocations* entry = FindSite(Profiler::CurrentSite());
+        entry->count.fetch_add(1, std::memory_order_relaxed);
+        entry->bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    static void RecordFree(void* pointer)
+    {
+        if (pointer) freeCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void* Allocate(size_t size)
+    {
+        void* pointer = std::malloc(size ? size : 1);
+        if (pointer) RecordAllocation(size);
+        return pointer;
+    }
+
+    static void* AllocateAligned(size_t size, std::align_val_t alignment)
+    {
+        size_t align = (size_t)alignment;
+#if defined(_WIN32)
+        void* pointer = _aligned_malloc(size ? size : 1, align);
+#else
+        void* pointer = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) & ~(align - 1));
+#endif
+        if (pointer) RecordAllocation(size);
+        return pointer;
+    }
+
+    static void FreeAligned(void* pointer)
+    {
+        RecordFree(pointer);
+#if defined(_WIN32)
+        _aligned_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+
+    void AllocationTracker::Frame()
+    {
+        static MetricCounter& allocationsMetric = Metrics::Counter("Memory/Allocations");
+        static MetricCounter& bytesMetric = Metrics::Counter("Memory/Bytes allocated");
+        static MetricCounter& freesMetric = Metrics::Counter("Memory/Frees");
+
+        // Previous totals, only touched here
+        static u64 lastCount = 0, lastBytes = 0, lastFrees = 0;
+        static u64 lastSiteCount[ALLOCATION_MAX_SITES + 1] = {};
+        static u64 lastSiteBytes[ALLOCATION_MAX_SITES + 1] = {};
+
+        // Reserved once, so closing a frame does not allocate itself
+        if (topScopes.capacity() == 0) topScopes.reserve(ALLOCATION_MAX_SITES + 1);
+
+        u64 count = allocationCount.load(std::memory_order_relaxed);
+        u64 bytes = allocationBytes.load(std::memory_order_relaxed);
+        u64 frees = freeCount.load(std::memory_order_relaxed);
+        frameCount = count - lastCount;
+        frameBytes = bytes - lastBytes;
+        frameFrees = frees - lastFrees;
+        lastCount = count;
+        lastBytes = bytes;
+        lastFrees = frees;
+
+        quietFrames = frameCount == 0 ? quietFrames + 1 : 0;
+
+        topScopes.clear();
+        for (u32 i = 0; i <= ALLOCATION_MAX_SITES; ++i)
+        {
+            SiteAllocations& entry = i < ALLOCATION_MAX_SITES ? siteAllocations[i] : unscoped;
+            const ProfileSite* site = entry.site.load(std::memory_order_acquire);
+            if (i < ALLOCATION_MAX_SITES && !site) continue;
+
+            u64 siteCount = entry.count.load(std::memory_order_relaxed);
+            u64 siteBytes = entry.bytes.load(std::memory_order_relaxed);
+            if (siteCount != lastSiteCount[i])
+            {
+                topScopes.push_back({ site, siteCount - lastSiteCount[i], siteBytes - lastSiteBytes[i], siteCount, siteBytes });
+            }
+            lastSiteCount[i] = siteCount;
+            lastSiteBytes[i] = siteBytes;
+        }
+        std::sort(topScopes.begin(), topScopes.end(), [](const AllocationStats& a, const AllocationStats& b) { return a.bytes > b.bytes; });
+
+        allocationsMetric.Add((i64)frameCount);
+        bytesMetric.Add((i64)frameBytes);
+        freesMetric.Add((i64)frameFrees);
+    }
+#else
+    void AllocationTracker::Frame()
+    {
+    }
+#endif
+}
+
+#ifdef ALLOCATION_TRACKING
+void* operator new(size_t size)
+{
+    void* pointer = Core::Allocate(size);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    void* pointer = Core::Allocate(size);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return Core::Allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return Core::Allocate(size); }
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    void* pointer = Core::AllocateAligned(size, alignment);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    void* pointer = Core::AllocateAligned(size, alignment);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return Core::AllocateAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return Core::AllocateAligned(size, alignment); }
+
+void operator delete(void* pointer) noexcept { Core::RecordFree(pointer); std::free(pointer); }
+void operator delete[](void* pointer) noexcept { Core::RecordFree(pointer); std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { Core::RecordFree(pointer); std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { Core::RecordFree(pointer); std::free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { Core::RecordFree(pointer); std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { Core::RecordFree(pointer); std::free(pointer); }
+
+void operator delete(void* pointer, std::align_val_t) noexcept { Core::FreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { Core::FreeAligned(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { Core::FreeAligned(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { Core::FreeAligned(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { Core::FreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { Core::FreeAligned(pointer); }
+#endif
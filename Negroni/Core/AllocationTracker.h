@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Base.h"
+#include "Profiler.h"
+
+#include <vector>
+
+// Define ALLOCATION_TRACKING to replace the global operator new/delete with counting ones.
+// Every allocation is charged to the innermost ProfileBlock of the allocating thread.
+
+namespace Core
+{
+    constexpr u32 ALLOCATION_MAX_SITES = 1024;    // A power of two
+
+    struct AllocationStats
+    {
+        const ProfileSite* site;    // nullptr for allocations outside of any ProfileBlock
+        u64 count = 0;              // Last frame
+        u64 bytes = 0;
+        u64 totalCount = 0;         // Since the start
+        u64 totalBytes = 0;
+    };
+
+    class AllocationTracker
+    {
+    public:
+        static constexpr bool Enabled()
+        {
+#ifdef ALLOCATION_TRACKING
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        // Closes the frame and feeds the Memory/* metrics, call right before Metrics::Sample()
+        static void Frame();
+
+        static u64 FrameAllocations() { return frameCount; }
+        static u64 FrameBytes() { return frameBytes; }
+        static u64 FrameFrees() { return frameFrees; }
+        // Frames in a row without a single allocation, the steady state goal
+        static u64 QuietFrames() { return quietFrames; }
+
+        // Scopes that allocated during the last frame, most bytes first
+        static const std::vector<AllocationStats>& TopScopes() { return topScopes; }
+
+    private:
+        inline static u64 frameCount = 0;
+        inline static u64 frameBytes = 0;
+        inline static u64 frameFrees = 0;
+        inline static u64 quietFrames = 0;
+        inline static std::vector<AllocationStats> topScopes;
+    };
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace Core
+{
+	// Keep independently written atomics on separate cache lines to avoid false sharing.
+	constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+	inline void CpuRelax()
+	{
+#if defined(_M_X64) || defined(__x86_64__)
+		_mm_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+	// Spin for a while, then start giving the time slice away.
+	class Backoff
+	{
+	public:
+		explicit Backoff(uint32_t spins = 64) : spins(spins) {}
+
+		void pause()
+		{
+			if (count < spins)
+			{
+				CpuRelax();
+				++count;
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		void reset() { count = 0; }
+
+	private:
+		uint32_t spins;
+		uint32_t count = 0;
+	};
+}
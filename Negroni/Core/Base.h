@@ -75,6 +75,11 @@ namespace Core
         Vec3f scale    = { 1.0f, 1.0f, 1.0f };
     };
 
+    // Logged by value, formatted later on the logger thread
+    template<> inline constexpr bool LogCopyable<Vec3f> = true;
+    template<> inline constexpr bool LogCopyable<Rot3f> = true;
+    template<> inline constexpr bool LogCopyable<Transform> = true;
+
     struct Vertex
     {
         Vec3f position;
@@ -124,15 +129,27 @@ namespace Core
     class Script
     {
     public:
-        virtual void FixedUpdate() = 0;
+        // fixedDt is the game time of one fixed step, the same every call
+        virtual void FixedUpdate(float fixedDt) = 0;
         virtual void Update(float) = 0;
         virtual str Name() = 0;
+
+        // Scripts driven only by coroutines set this to false,
+        // so the game loop never calls their FixedUpdate and Update
+        bool updates = true;
+
+        // Opt-in: Update may then run on a job worker, at the same time as other such scripts.
+        // It must only touch its own object and its own members. Input, Keyboard, Mouse, timers,
+        // coroutines and other objects are off limits, those scripts stay serial.
+        bool parallelUpdate = false;
     };
 
     class NullScript : public Script
     {
     public:
-        virtual void FixedUpdate() override {}
+        NullScript() { updates = false; }
+
+        virtual void FixedUpdate(float) override {}
         virtual void Update(float) override {}
         virtual str Name() override { return "<NULL>"; }
     };
@@ -150,6 +167,11 @@ namespace Core
         ScriptRef      script = MakeRef<NullScript>();
         MeshRef        mesh;
         bool           selected = false;
+
+        // Drawn between its transforms of the last two fixed steps, for objects moved in FixedUpdate.
+        // Set previousTransform together with transform when placing or teleporting the object.
+        bool           interpolate = false;
+        Transform      previousTransform;
     };
 
     typedef Ref<Object>	ObjectRef;
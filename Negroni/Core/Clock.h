@@ -1,6 +1,16 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#endif
 
 namespace Core
 {
@@ -8,16 +18,95 @@ namespace Core
 	{
 	public:
 		typedef uint64_t millisec;
+		typedef uint64_t nanosec;
 
+		// Monotonic, in milliseconds
 		static millisec now()
 		{
-			TimePoint tp = HRClock::now();
-			return tp.time_since_epoch().count();
+			return nanos() / 1'000'000;
+		}
+
+		// Monotonic, in nanoseconds
+		static nanosec nanos()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(SteadyClock::now().time_since_epoch()).count();
+		}
+
+		// Startup step, call first thing in main() before any other thread runs. Uses the CPU
+		// timestamp counter for ticks() when CPUID reports an invariant one, which ticks at a
+		// constant rate through frequency changes and sleep states, and measures that rate
+		// against the steady clock. Busy-waits about 10 ms.
+		static void Calibrate()
+		{
+			if (!HasInvariantTsc()) return;
+
+			tickNanos = MeasureTsc();
+			useTsc = true;
+		}
+
+		// The cheapest clock to read: the invariant TSC after Calibrate(), nanos() before it and
+		// on CPUs without one. Only differences between two reads are meaningful, convert them
+		// with ticksToNanos().
+		static uint64_t ticks()
+		{
+#if defined(_M_X64) || defined(__x86_64__)
+			if (useTsc) return __rdtsc();
+#endif
+			return nanos();
+		}
+
+		static double ticksToNanos(uint64_t ticks)
+		{
+			return ticks * nanosPerTick();
+		}
+
+		static double nanosPerTick()
+		{
+			return tickNanos;
 		}
 
 	private:
-		typedef std::chrono::high_resolution_clock HRClock;
-		typedef std::chrono::duration<double, std::milli> Duration;
-		typedef std::chrono::time_point<HRClock, Duration> TimePoint;
+		typedef std::chrono::steady_clock SteadyClock;
+
+		// Written once by Calibrate(), before the threads that read them start
+		inline static bool useTsc = false;
+		inline static double tickNanos = 1.0;
+
+		// CPUID leaf 0x80000007, EDX bit 8
+		static bool HasInvariantTsc()
+		{
+#if defined(_M_X64) || defined(__x86_64__)
+#if defined(_MSC_VER)
+			int registers[4];
+			__cpuid(registers, 0x80000000);
+			if ((unsigned)registers[0] < 0x80000007) return false;
+			__cpuid(registers, 0x80000007);
+			return (registers[3] & (1 << 8)) != 0;
+#else
+			unsigned eax, ebx, ecx, edx;
+			if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+			return (edx & (1 << 8)) != 0;
+#endif
+#else
+			return false;
+#endif
+		}
+
+		static double MeasureTsc()
+		{
+#if defined(_M_X64) || defined(__x86_64__)
+			constexpr nanosec CALIBRATION_TIME = 10'000'000;
+
+			nanosec startNanos = nanos();
+			uint64_t startTicks = __rdtsc();
+			while (nanos() - startNanos < CALIBRATION_TIME) {}
+			nanosec endNanos = nanos();
+			uint64_t endTicks = __rdtsc();
+
+			return double(endNanos - startNanos) / double(endTicks - startTicks);
+#else
+			return 1.0;
+#endif
+		}
 	};
 }
@@ -0,0 +1,229 @@
+#pragma once
+
+#include "Base.h"
+#include "JobSystem.h"
+#include "Time.h"
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Coroutines for scripts, resumed by the Scheduler that GameLoop ticks every frame.
+//
+//  Task Blink(ObjectRef object)
+//  {
+//      while (true)
+//      {
+//          object->useTintColor = !object->useTintColor;
+//          co_await WaitForSeconds(0.5f);
+//      }
+//  }
+//
+//  scheduler.Start(Blink(object));
+
+namespace Core
+{
+    class Scheduler;
+
+    // Owns a coroutine until it is handed to a Scheduler with Start().
+    // The coroutine does not run before that.
+    class Task
+    {
+    public:
+        struct promise_type
+        {
+            Scheduler* scheduler = nullptr;
+
+            Task get_return_object() { return Task(Handle::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+
+        typedef std::coroutine_handle<promise_type> Handle;
+
+        Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task()
+        {
+            if (handle) handle.destroy();
+        }
+
+        Handle release() { return std::exchange(handle, nullptr); }
+
+    private:
+        explicit Task(Handle handle) : handle(handle) {}
+
+        Handle handle;
+    };
+
+    // Suspended coroutines sit in min-heaps keyed by the frame or time they are due,
+    // so waiting costs nothing until then. Only job waits are polled, once per frame.
+    // Seconds and frames are counted in the scheduler's time domain, nothing is
+    // resumed while it is paused.
+    // Not thread-safe: Start(), Tick() and FixedTick() belong to the game loop thread.
+    class Scheduler
+    {
+    public:
+        typedef Task::Handle Handle;
+
+        explicit Scheduler(const TimeDomain& domain = Time::Game()) : domain(domain) {}
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        ~Scheduler()
+        {
+            while (!frameWaits.empty()) { frameWaits.top().handle.destroy(); frameWaits.pop(); }
+            while (!timeWaits.empty()) { timeWaits.top().handle.destroy(); timeWaits.pop(); }
+            for (Handle handle : fixedWaits) handle.destroy();
+            for (auto& [counter, handle] : jobWaits) handle.destroy();
+        }
+
+        // Runs the coroutine until its first co_await
+        void Start(Task task)
+        {
+            Handle handle = task.release();
+            if (!handle) return;
+
+            handle.promise().scheduler = this;
+            ++count;
+            Resume(handle);
+        }
+
+        // Once per frame, after the scripts are updated and the domain is advanced
+        void Tick()
+        {
+            if (domain.Paused()) return;
+
+            ++frame;
+            double time = domain.Seconds();
+
+            while (!frameWaits.empty() && frameWaits.top().due <= frame)
+            {
+                Handle handle = frameWaits.top().handle;
+                frameWaits.pop();
+                Resume(handle);
+            }
+
+            while (!timeWaits.empty() && timeWaits.top().due <= time)
+            {
+                Handle handle = timeWaits.top().handle;
+                timeWaits.pop();
+                Resume(handle);
+            }
+
+            for (size_t i = 0; i < jobWaits.size();)
+            {
+                auto [counter, handle] = jobWaits[i];
+                if (!counter->Done()) { ++i; continue; }
+
+                jobWaits[i] = jobWaits.back();
+                jobWaits.pop_back();
+                Resume(handle);
+            }
+        }
+
+        // Once per fixed step, after the scripts' FixedUpdate
+        void FixedTick()
+        {
+            // Coroutines waiting again during this step are resumed on the next one
+            fixedResumes.swap(fixedWaits);
+            for (Handle handle : fixedResumes) Resume(handle);
+            fixedResumes.clear();
+        }
+
+        // Coroutines started and not finished yet
+        u32 Count() const { return count; }
+
+        u64 Frame() const { return frame; }
+        const TimeDomain& Domain() const { return domain; }
+
+        void WaitFrames(Handle handle, u32 frames) { frameWaits.push({ frame + std::max(frames, 1u), handle }); }
+        void WaitSeconds(Handle handle, float seconds)
+        {
+            // A zero wait would be resumed again in the same Tick
+            if (seconds <= 0.0f) WaitFrames(handle, 1);
+            else timeWaits.push({ domain.Seconds() + seconds, handle });
+        }
+        void WaitFixedUpdate(Handle handle) { fixedWaits.push_back(handle); }
+        void WaitJob(Handle handle, JobCounter& counter) { jobWaits.push_back({ &counter, handle }); }
+
+    private:
+        template<typename DueType>
+        struct Wait
+        {
+            DueType due;
+            Handle  handle;
+
+            bool operator>(const Wait& other) const { return due > other.due; }
+        };
+
+        template<typename DueType>
+        using MinHeap = std::priority_queue<Wait<DueType>, std::vector<Wait<DueType>>, std::greater<Wait<DueType>>>;
+
+        void Resume(Handle handle)
+        {
+            handle.resume();
+            if (handle.done())
+            {
+                handle.destroy();
+                --count;
+            }
+        }
+
+        const TimeDomain& domain;
+        u64 frame = 0;
+        u32 count = 0;
+
+        MinHeap<u64>    frameWaits;
+        MinHeap<double> timeWaits;
+        std::vector<Handle> fixedWaits;
+        std::vector<Handle> fixedResumes;
+        std::vector<std::pair<JobCounter*, Handle>> jobWaits;
+    };
+
+    //------------------------------------------------------------------------------------
+    // Awaitables
+    //------------------------------------------------------------------------------------
+
+    struct WaitForFrames
+    {
+        u32 frames = 1;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(Task::Handle handle) const { handle.promise().scheduler->WaitFrames(handle, frames); }
+        void await_resume() const noexcept {}
+    };
+
+    struct WaitForSeconds
+    {
+        float seconds;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(Task::Handle handle) const { handle.promise().scheduler->WaitSeconds(handle, seconds); }
+        void await_resume() const noexcept {}
+    };
+
+    struct WaitForFixedUpdate
+    {
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(Task::Handle handle) const { handle.promise().scheduler->WaitFixedUpdate(handle); }
+        void await_resume() const noexcept {}
+    };
+
+    // Resumes on the first frame after every job attached to the counter has finished
+    struct WaitForJob
+    {
+        JobCounter& counter;
+
+        bool await_ready() const noexcept { return counter.Done(); }
+        void await_suspend(Task::Handle handle) const { handle.promise().scheduler->WaitJob(handle, counter); }
+        void await_resume() const noexcept {}
+    };
+}
@@ -0,0 +1,132 @@
+#include "FlightRecorder.h"
+#include "Logger.h"
+
+#include <cstdio>
+#include <mutex>
+#include <new>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Core
+{
+    static std::mutex siteMutex;
+    static FlightSite* sites = nullptr;
+    static char* mapped = nullptr;
+
+    static std::atomic<uint32_t> threadCount = 0;
+    static thread_local uint32_t threadIndex = 0;
+
+    static void copyText(char* to, size_t capacity, std::string_view text)
+    {
+        size_t size = std::min<size_t>(text.size(), capacity - 1);
+        memcpy(to, text.data(), size);
+        to[size] = '\0';
+    }
+
+    // Maps size bytes of a freshly created file, the mapping is never closed:
+    // log calls may come from any thread until the process is gone
+    static char* mapFile(const char* path, size_t size)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, nullptr);
+        CloseHandle(file);
+        if (!mapping) return nullptr;
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        CloseHandle(mapping);
+        return (char*)view;
+#else
+        int file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (file < 0) return nullptr;
+
+        if (ftruncate(file, (off_t)size) != 0)
+        {
+            close(file);
+            return nullptr;
+        }
+
+        void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        close(file);
+        return view == MAP_FAILED ? nullptr : (char*)view;
+#endif
+    }
+
+    bool FlightRecorder::Open(const char* path)
+    {
+        if (mapped) return true;
+
+        // Keep the recording of the previous run, it is the interesting one after a crash
+        std::string previous = std::string(path) + ".prev";
+        std::remove(previous.c_str());
+        std::rename(path, previous.c_str());
+
+        mapped = mapFile(path, FLIGHT_FILE_SIZE);
+        if (!mapped) return false;
+
+        // A new file reads as zeros, so every slot starts out empty
+        header = new (mapped) FlightHeader();
+        header->slotSize = FLIGHT_SLOT_SIZE;
+        header->slotCount = FLIGHT_SLOT_COUNT;
+        header->maxSites = FLIGHT_MAX_SITES;
+        header->startNanos = Clock::nanos();
+        sites = (FlightSite*)(mapped + FLIGHT_SITES_OFFSET);
+        memcpy(header->magic, FLIGHT_MAGIC, sizeof(FLIGHT_MAGIC));
+
+        slots = (FlightSlot*)(mapped + FLIGHT_SLOTS_OFFSET);
+        return true;
+    }
+
+    void FlightRecorder::Flush()
+    {
+        if (!mapped) return;
+
+#if defined(_WIN32)
+        FlushViewOfFile(mapped, FLIGHT_FILE_SIZE);
+#else
+        msync(mapped, FLIGHT_FILE_SIZE, MS_ASYNC);
+#endif
+    }
+
+    uint32_t FlightRecorder::Register(const LogSite& site, LogSiteId& siteId, std::string_view format)
+    {
+        std::lock_guard<std::mutex> guard(siteMutex);
+
+        uint32_t id = siteId.load(std::memory_order_acquire);
+        if (id != 0) return id;
+
+        uint32_t index = header->siteCount.load(std::memory_order_relaxed);
+        if (index >= FLIGHT_MAX_SITES)
+        {
+            // Table is full, this call site is not recorded
+            siteId.store(UINT32_MAX, std::memory_order_release);
+            return UINT32_MAX;
+        }
+
+        FlightSite& entry = sites[index];
+        entry.level = (uint32_t)site.level;
+        entry.line = site.line;
+        copyText(entry.location, sizeof(entry.location), site.location);
+        copyText(entry.file, sizeof(entry.file), site.file);
+        copyText(entry.format, sizeof(entry.format), format);
+        header->siteCount.store(index + 1, std::memory_order_release);
+
+        siteId.store(index + 1, std::memory_order_release);
+        return index + 1;
+    }
+
+    uint32_t FlightRecorder::ThreadIndex()
+    {
+        if (threadIndex == 0) threadIndex = threadCount.fetch_add(1, std::memory_order_relaxed) + 1;
+        return threadIndex;
+    }
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Crash-safe log: every log record is also written into a memory-mapped file,
+// so the last few thousand lines survive a crash or a hang even when the logger
+// thread never got to them. Decode the file with the FlightDecoder tool.
+//
+// File layout: FlightHeader, FLIGHT_MAX_SITES x FlightSite, FLIGHT_SLOT_COUNT x FlightSlot.
+
+namespace Core
+{
+    struct LogSite;
+    struct LogFormatted;
+
+    constexpr char     FLIGHT_MAGIC[8]   = "NGRFLT1";
+    constexpr uint32_t FLIGHT_SLOT_SIZE  = 256;
+    constexpr uint32_t FLIGHT_SLOT_COUNT = 16 * 1024;   // 4 MB of records
+    constexpr uint32_t FLIGHT_MAX_SITES  = 1024;
+
+    enum class FlightArg : uint8_t { Int, UInt, Float, Bool, Char, Pointer, String };
+
+    struct FlightHeader
+    {
+        char                  magic[8];
+        uint32_t              slotSize;
+        uint32_t              slotCount;
+        uint32_t              maxSites;
+        std::atomic<uint32_t> siteCount;
+        std::atomic<uint64_t> next;         // Sequence number of the next record
+        uint64_t              startNanos;   // Clock::nanos() when the file was opened
+    };
+
+    // A log call site, written once on its first record
+    struct FlightSite
+    {
+        uint32_t level;
+        uint32_t line;
+        char     location[120];
+        char     file[128];
+        char     format[256];
+    };
+
+    // One record. Arguments are stored as a FlightArg tag followed by the value,
+    // whatever does not fit in the payload is dropped.
+    struct FlightSlot
+    {
+        std::atomic<uint64_t> sequence;     // Record sequence number + 1 once complete, 0 while being written
+        uint64_t timestamp;
+        uint32_t site;                      // Index into the site table + 1
+        uint32_t thread;
+        uint16_t size;
+        uint8_t  argCount;
+        uint8_t  truncated;
+        uint32_t reserved;
+        char     payload[FLIGHT_SLOT_SIZE - 32];
+    };
+
+    static_assert(sizeof(FlightSlot) == FLIGHT_SLOT_SIZE);
+
+    constexpr size_t FLIGHT_SITES_OFFSET = 64;
+    constexpr size_t FLIGHT_SLOTS_OFFSET = FLIGHT_SITES_OFFSET + FLIGHT_MAX_SITES * sizeof(FlightSite);
+    constexpr size_t FLIGHT_FILE_SIZE    = FLIGHT_SLOTS_OFFSET + FLIGHT_SLOT_COUNT * sizeof(FlightSlot);
+
+    static_assert(sizeof(FlightHeader) <= FLIGHT_SITES_OFFSET);
+
+    typedef std::atomic<uint32_t> LogSiteId;
+
+    class FlightRecorder
+    {
+    public:
+        // Maps the file, a recording left by the previous run is kept as <path>.prev
+        static bool Open(const char* path);
+        // Asks the OS to write the mapped pages to disk now
+        static void Flush();
+
+        static bool Enabled() { return slots != nullptr; }
+
+        template<typename... Prepared>
+        static void Write(const LogSite& site, LogSiteId& siteId, std::string_view format, uint64_t timestamp, const Prepared&... args)
+        {
+            uint32_t id = siteId.load(std::memory_order_acquire);
+            if (id == 0) id = Register(site, siteId, format);
+            if (id == UINT32_MAX) return;
+
+            uint64_t sequence = header->next.fetch_add(1, std::memory_order_relaxed);
+            FlightSlot& slot = slots[sequence % FLIGHT_SLOT_COUNT];
+
+            slot.sequence.store(0, std::memory_order_relaxed);
+            slot.timestamp = timestamp;
+            slot.site = id;
+            slot.thread = ThreadIndex();
+            slot.argCount = 0;
+            slot.truncated = 0;
+
+            uint32_t size = 0;
+            (Put(slot, size, args), ...);
+            slot.size = (uint16_t)size;
+
+            slot.sequence.store(sequence + 1, std::memory_order_release);
+        }
+
+    private:
+        static uint32_t Register(const LogSite& site, LogSiteId& siteId, std::string_view format);
+        static uint32_t ThreadIndex();
+
+        static bool Append(FlightSlot& slot, uint32_t& size, FlightArg tag, const void* value, uint32_t valueSize)
+        {
+            if (slot.truncated || size + 1 + valueSize > sizeof(slot.payload))
+            {
+                slot.truncated = 1;
+                return false;
+            }
+
+            slot.payload[size] = (char)tag;
+            memcpy(slot.payload + size + 1, value, valueSize);
+            size += 1 + valueSize;
+            slot.argCount++;
+            return true;
+        }
+
+        static void PutString(FlightSlot& slot, uint32_t& size, std::string_view value)
+        {
+            if (slot.truncated) return;
+
+            // Long strings are cut to what is left of the payload
+            uint32_t room = sizeof(slot.payload) - size;
+            if (room < 1 + sizeof(uint16_t))
+            {
+                slot.truncated = 1;
+                return;
+            }
+            uint16_t length = (uint16_t)std::min<size_t>(value.size(), room - 1 - sizeof(uint16_t));
+
+            slot.payload[size] = (char)FlightArg::String;
+            memcpy(slot.payload + size + 1, &length, sizeof(length));
+            memcpy(slot.payload + size + 1 + sizeof(length), value.data(), length);
+            size += 1 + sizeof(length) + length;
+            slot.argCount++;
+        }
+
+        template<typename T>
+        static void Put(FlightSlot& slot, uint32_t& size, const T& arg)
+        {
+            if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>)
+            {
+                PutString(slot, size, arg);
+            }
+            else if constexpr (std::is_same_v<T, LogFormatted>)
+            {
+                // Already formatted for the log buffer
+                PutString(slot, size, arg.text);
+            }
+            else if constexpr (std::is_same_v<T, bool>)
+            {
+                Append(slot, size, FlightArg::Bool, &arg, 1);
+            }
+            else if constexpr (std::is_same_v<T, char>)
+            {
+                Append(slot, size, FlightArg::Char, &arg, 1);
+            }
+            else if constexpr (std::is_enum_v<T>)
+            {
+                Put(slot, size, (std::underlying_type_t<T>)arg);
+            }
+            else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+            {
+                int64_t value = arg;
+                Append(slot, size, FlightArg::Int, &value, sizeof(value));
+            }
+            else if constexpr (std::is_integral_v<T>)
+            {
+                uint64_t value = arg;
+                Append(slot, size, FlightArg::UInt, &value, sizeof(value));
+            }
+            else if constexpr (std::is_floating_point_v<T>)
+            {
+                double value = arg;
+                Append(slot, size, FlightArg::Float, &value, sizeof(value));
+            }
+            else if constexpr (std::is_pointer_v<T>)
+            {
+                uint64_t value = (uint64_t)(uintptr_t)arg;
+                Append(slot, size, FlightArg::Pointer, &value, sizeof(value));
+            }
+            else
+            {
+                // No tag for it, the decoder gets the text. Formatted on the stack, nothing here allocates.
+                char text[sizeof(slot.payload)];
+                auto result = std::format_to_n(text, sizeof(text), "{}", arg);
+                PutString(slot, size, std::string_view(text, std::min<size_t>((size_t)result.size, sizeof(text))));
+            }
+        }
+
+        inline static FlightHeader* header = nullptr;
+        inline static FlightSlot*   slots = nullptr;
+    };
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Base.h"
+#include "Clock.h"
+
+namespace Core
+{
+    // Frame timing of the game, GameLoop::frameTime is the one instance. Whichever loop
+    // drives GameLoop::Update (the main loop or the game thread) calls Tick() once per frame,
+    // at the same point of every frame.
+    class FrameTime
+    {
+    public:
+        // Returns the seconds since the previous Tick(), 0 for the first one
+        float Tick()
+        {
+            Clock::nanosec now = Clock::nanos();
+            deltaNanos = frame == 0 ? 0 : now - last;
+            last = now;
+
+            dt = deltaNanos / 1e9f;
+            ++frame;
+
+            return dt;
+        }
+
+        float DeltaTime() const { return dt; }
+        Clock::nanosec DeltaNanos() const { return deltaNanos; }
+        // Number of Tick() calls so far
+        u64 Frame() const { return frame; }
+
+    private:
+        Clock::nanosec last = 0;
+        Clock::nanosec deltaNanos = 0;
+        float dt = 0.0f;
+        u64   frame = 0;
+    };
+}
@@ -1,9 +1,18 @@
 #pragma once
 
 #include "Base.h"
+#include "Coroutine.h"
+#include "FrameTime.h"
 #include "Input.h"
+#include "JobSystem.h"
 #include "Keyboard.h"
+#include "Metrics.h"
+#include "ObjectInspector.h"
 #include "Profiler.h"
+#include "RenderList.h"
+#include "Time.h"
+
+#include <cmath>
 
 // Usefull source: https://docs.unity3d.com/6000.2/Documentation/Manual/execution-order.html
 
@@ -12,6 +21,9 @@ namespace Core
     struct GameState
     {
         std::vector<ObjectRef> objects;
+
+        // How far the frame is between the last fixed step and the next one, in [0, 1)
+        float interpolationAlpha = 0.0f;
     };
 
 	class GameLoop
@@ -19,41 +31,132 @@ namespace Core
 	public:
         GameState& Update(InputEvent& input, float dt)
         {
-            // NOTE: When the FPS is too high, delta time can be 0 for many frames in a row.  
-            // If there is no user input, the game state remains exactly the same.  
-            // Therefore, we can safely skip unnecessary calculations.  
-            // PS: Even though dt is a float, comparing dt == 0 is still valid here. 
+            // NOTE: Frame times are measured in nanoseconds, so dt is 0 only for the very first frame.
+            // If there is no user input then, the game state remains exactly the same.
             if (input.isDirty == false && dt == 0) return state;
 
-            static const float fixedDeltaTime = 1.0f / 60.0f;
-            static float cumulativeDeltaTime = 0.0f;
+            ProfileBlock("[GameLoop] Update");
+
+            inspector.ApplyEdits();
+
+            Time::Real().Advance(dt);
+            dt = time.DeltaTime();
+
+            const float fixedDeltaTime = 1.0f / fixedRate;
+
+            // Before the fixed steps, the scripts read it in FixedUpdate as well
+            Input::Update(input);
 
             cumulativeDeltaTime += dt;
-            while (cumulativeDeltaTime >= fixedDeltaTime)
+            for (u32 step = 0; cumulativeDeltaTime >= fixedDeltaTime; ++step)
             {
+                if (step == maxSubsteps)
+                {
+                    // Spiral of death guard: the simulation cannot keep up, drop the time it is behind
+                    cumulativeDeltaTime = std::fmod(cumulativeDeltaTime, fixedDeltaTime);
+                    break;
+                }
+
                 for (auto& object : state.objects)
                 {
-                    object->script->FixedUpdate();
+                    if (object->interpolate) object->previousTransform = object->transform;
+                    if (object->script->updates) object->script->FixedUpdate(fixedDeltaTime);
                 }
+                scheduler.FixedTick();
                 //physics.Update(fixedDeltaTime);
                 cumulativeDeltaTime -= fixedDeltaTime;
             }
-
-            Input::Update(input);
+            state.interpolationAlpha = cumulativeDeltaTime / fixedDeltaTime;
 
             {
-                //ProfileBlock _("All objects script update");
+                ProfileBlock("[GameLoop] Scripts Update");
 
-                //#pragma omp parallel for num_threads(numThreads)
-                for (auto& object : state.objects)
+                // Serial in object order, except scripts that opted in to parallelUpdate
+                parallelScripts.clear();
+                for (u32 i = 0; i < (u32)state.objects.size(); ++i)
                 {
-                    object->script->Update(dt);
+                    Script& script = *state.objects[i]->script;
+                    if (!script.updates) continue;
+
+                    if (script.parallelUpdate)
+                        parallelScripts.push_back(i);
+                    else
+                        script.Update(dt);
                 }
+
+                JobSystem::ParallelFor((u32)parallelScripts.size(), updateGrainSize, [this, dt](u32 i) {
+                    state.objects[parallelScripts[i]]->script->Update(dt);
+                });
             }
 
+            scheduler.Tick();
+
+            static MetricGauge& objectCount = Metrics::Gauge("Game/Objects");
+            static MetricGauge& activeScripts = Metrics::Gauge("Game/Active scripts");
+            static MetricGauge& coroutines = Metrics::Gauge("Game/Coroutines");
+            u32 active = 0;
+            for (auto& object : state.objects)
+                if (object->script->updates) ++active;
+            objectCount.Set((double)state.objects.size());
+            activeScripts.Set(active);
+            coroutines.Set((double)scheduler.Count());
+
+            inspector.Publish();
+
             return state;
         }
 
+        // Snapshot of the objects for the renderer, written straight into the caller's buffer
+        // after Update(). A reused list keeps its capacity, so this only allocates when the scene grows.
+        void ExtractRenderList(RenderList& renderList) const
+        {
+            ProfileBlock("[GameLoop] Extract Render List");
+            renderList.resize(state.objects.size());
+
+            JobSystem::ParallelFor((u32)state.objects.size(), updateGrainSize, [this, &renderList](u32 i) {
+                renderList[i] = MakeRenderProxy(*state.objects[i], state.interpolationAlpha);
+            });
+        }
+
         GameState state;
+
+        // Scripts, the fixed step and the coroutines all run on this clock, see Time.h
+        TimeDomain& time = Time::Game();
+
+        // Measures the dt passed to Update(), ticked by the loop that drives it
+        FrameTime frameTime;
+
+        // The object shown by the editor, which may run on the render thread
+        ObjectInspector inspector;
+
+        // Resumes the coroutines started by scripts, see Coroutine.h
+        Scheduler scheduler{ time };
+
+        // Objects per job when parallelUpdate scripts and the render list run on the job system.
+        // Fewer objects than this are handled inline on the calling thread.
+        u32 updateGrainSize = 256;
+
+        // Fixed steps per second of game time, independent of the frame rate.
+        // Rates that are not positive are rejected and the current one is kept.
+        bool SetFixedRate(float rate)
+        {
+            if (!(rate > 0.0f) || !std::isfinite(rate))
+            {
+                log_error("invalid fixed rate {}, keeping {}", rate, fixedRate);
+                return false;
+            }
+            fixedRate = rate;
+            return true;
+        }
+        float FixedRate() const { return fixedRate; }
+
+        // Most fixed steps a single frame may run before the remaining time is dropped
+        u32 maxSubsteps = 8;
+
+    private:
+        float fixedRate = 60.0f;
+        float cumulativeDeltaTime = 0.0f;
+        // Indices of the objects whose scripts update in parallel, kept to reuse its capacity
+        std::vector<u32> parallelScripts;
 	};
 }
\ No newline at end of file
@@ -5,13 +5,20 @@
 #include "Gui.h"
 #include "GameLoop.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <thread>
 
 namespace Core
 {
-    typedef std::function<void(const GameState&)> UpdateFunc;
+    typedef std::function<void(const GameLoop&)> UpdateFunc;
 
+    // Longest WaitFrame() blocks the window thread between two message pumps
+    constexpr u32 GAME_THREAD_WAIT_MS = 10;
+
+    // Runs GameLoop::Update on its own thread and hands every finished frame to onUpdate.
+    // The window thread feeds input through Update() and may pace itself with WaitFrame().
     class GameThread
     {
     public:
@@ -25,15 +32,50 @@ namespace Core
             Stop();
         }
 
-        void Update(std::vector<KeyStatus>& input)
+        // Input events that arrive between two game frames are merged: the latest key and
+        // mouse state wins, the press and release edges accumulate and the scroll deltas add up.
+        void Update(const InputEvent& newInput)
         {
+            if (!newInput.isDirty) return;
+
             std::lock_guard<std::mutex> guard(key);
-            this->input = input;
+            float scrollDelta = input.mouseScrollDelta + newInput.mouseScrollDelta;
+            bool pressed[KEYS_IN_USE_LENGTH], released[KEYS_IN_USE_LENGTH];
+            for (u32 i = 0; i < KEYS_IN_USE_LENGTH; ++i)
+            {
+                pressed[i] = input.keysPressed[i] || newInput.keysPressed[i];
+                released[i] = input.keysReleased[i] || newInput.keysReleased[i];
+            }
+
+            input = newInput;
+            input.mouseScrollDelta = scrollDelta;
+            memcpy(input.keysPressed, pressed, sizeof(pressed));
+            memcpy(input.keysReleased, released, sizeof(released));
         }
 
+        // Blocks until the game thread finishes its next frame or timeoutMs pass, false on timeout.
+        // The window thread must keep pumping messages meanwhile: Present() and ResizeBuffers()
+        // on the render thread may wait for it.
+        bool WaitFrame(u32 timeoutMs = GAME_THREAD_WAIT_MS)
+        {
+            u64 seen = frame.load(std::memory_order_acquire);
+            std::unique_lock<std::mutex> lock(frameMutex);
+            return frameDone.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, seen] {
+                return quit || frame.load(std::memory_order_acquire) != seen;
+            });
+        }
+
+        // Ends the thread after its current frame, without waiting for it
+        void RequestStop()
+        {
+            quit = true;
+        }
+
+        // Set when the thread is done, Stop() then joins without blocking
+        bool Exited() const { return exited.load(std::memory_order_acquire); }
+
         void Stop()
         {
-            //std::lock_guard<std::mutex> guard(key);
             quit = true;
 
             if (thread.joinable())
@@ -43,12 +85,13 @@ namespace Core
             }
         }
 
+        const ThreadFrameStats& Stats() const { return stats; }
+
     private:
         static void Start(GameThread* self)
         {
             log_info("started");
-
-            const float color[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+            ProfileThread("Game thread");
 
             while (true)
             {
@@ -58,34 +101,59 @@ namespace Core
                     break;
                 }
 
-                float dt = DeltaTime();
-                std::lock_guard<std::mutex> guard(self->key);
-                //auto& gameState = self->game.Update(self->input, dt);
-                //self->onUpdate(gameState);
-                self->input.clear();
+                auto frameStart = high_resolution_clock::now();
+
+                InputEvent input = self->TakeInput();
+                float dt = self->game.frameTime.Tick();
+                self->game.Update(input, dt);
+
+                auto handoffStart = high_resolution_clock::now();
+                self->onUpdate(self->game);
+                auto frameEnd = high_resolution_clock::now();
+
+                self->stats.busyMs = duration<float, std::milli>(handoffStart - frameStart).count();
+                self->stats.waitMs = duration<float, std::milli>(frameEnd - handoffStart).count();
+                self->stats.frames++;
+                ProfileFrame();
+
+                self->FrameDone();
             }
+
+            // Release a window thread still waiting for a frame
+            self->FrameDone();
+            self->exited.store(true, std::memory_order_release);
         }
 
-        static float DeltaTime()
+        void FrameDone()
         {
-            static u64 timeStart = Clock::now();
-            static u64 timeCur = Clock::now();
-            static float t = (timeCur - timeStart) / 1000.0f;
-            static float prev_t = t;
-
-            timeCur = Clock::now();
-            t = (timeCur - timeStart) / 1000.0f;
-            float dt = t - prev_t;
-            prev_t = t;
+            {
+                std::lock_guard<std::mutex> guard(frameMutex);
+                frame.fetch_add(1, std::memory_order_release);
+            }
+            frameDone.notify_all();
+        }
 
-            return dt;
+        InputEvent TakeInput()
+        {
+            std::lock_guard<std::mutex> guard(key);
+            InputEvent taken = input;
+            input.isDirty = false;
+            input.mouseScrollDelta = 0;
+            memset(input.keysPressed, 0, sizeof(input.keysPressed));
+            memset(input.keysReleased, 0, sizeof(input.keysReleased));
+            return taken;
         }
 
         GameLoop& game;
         UpdateFunc onUpdate;
         std::thread thread;
         std::mutex key;
-        std::vector<KeyStatus> input;
-        bool quit = false;
+        InputEvent input;
+        std::atomic<u64> frame = 0;
+        std::mutex frameMutex;
+        std::condition_variable frameDone;
+        std::atomic<bool> quit = false;
+        std::atomic<bool> exited = false;
+        ThreadFrameStats stats;
     };
 }
@@ -3,6 +3,7 @@
 #include "Base.h"
 #include "Profiler.h"
 
+#include <atomic>
 #include <deque>
 
 namespace Core
@@ -12,7 +13,8 @@ namespace Core
 	public:
 		virtual void Draw() = 0;
 
-		bool visible = true;
+		// Toggled from key callbacks, read by the thread drawing the GUI
+		std::atomic<bool> visible = true;
 	};
 
 	class Gui
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Base.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace Core
+{
+    // HDR-style histogram of u64 values, nanoseconds usually. Values below SUB_BUCKETS are
+    // counted exactly, above that every power of two is split into SUB_BUCKETS buckets,
+    // so a value is known within 1/SUB_BUCKETS (~6%) of itself over the whole u64 range.
+    class Histogram
+    {
+    public:
+        static constexpr u32 SUB_BITS    = 4;
+        static constexpr u32 SUB_BUCKETS = 1 << SUB_BITS;
+        static constexpr u32 BUCKETS     = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+        void Record(u64 value)
+        {
+            ++counts[Index(value)];
+            ++count;
+            sum += value;
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+
+        void Merge(const Histogram& other)
+        {
+            if (other.count == 0) return;
+
+            for (u32 i = 0; i < BUCKETS; ++i) counts[i] += other.counts[i];
+            count += other.count;
+            sum += other.sum;
+            min = std::min(min, other.min);
+            max = std::max(max, other.max);
+        }
+
+        void Clear()
+        {
+            *this = Histogram();
+        }
+
+        u64 Count() const { return count; }
+        u64 Min() const { return count ? min : 0; }
+        u64 Max() const { return max; }
+        double Mean() const { return count ? double(sum) / count : 0.0; }
+
+        // Value below which `percentile` (0-100) of the recorded values fall, within bucket precision
+        u64 Percentile(double percentile) const
+        {
+            if (count == 0) return 0;
+
+            u64 rank = std::max<u64>(1, u64(percentile / 100.0 * count + 0.5));
+            u64 seen = 0;
+            for (u32 i = 0; i < BUCKETS; ++i)
+            {
+                seen += counts[i];
+                if (seen >= rank) return std::clamp(Middle(i), min, max);
+            }
+            return max;
+        }
+
+    private:
+        static u32 Index(u64 value)
+        {
+            if (value < SUB_BUCKETS) return (u32)value;
+
+            u32 exponent = (u32)std::bit_width(value) - 1;
+            u32 sub = (u32)(value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1);
+            return (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+        }
+
+        static u64 Middle(u32 index)
+        {
+            if (index < SUB_BUCKETS) return index;
+
+            u32 exponent = index / SUB_BUCKETS + SUB_BITS - 1;
+            u32 shift = exponent - SUB_BITS;
+            u64 lower = u64(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+            return lower + ((1ull << shift) >> 1);
+        }
+
+        u32 counts[BUCKETS] = {};
+        u64 count = 0;
+        u64 sum = 0;
+        u64 min = UINT64_MAX;
+        u64 max = 0;
+    };
+}
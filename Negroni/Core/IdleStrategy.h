@@ -0,0 +1,148 @@
+#pragma once
+
+#include "Atomic.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <thread>
+
+namespace Core
+{
+	// What a consumer thread does while its queue is empty:
+	// spin for `spins` iterations, then yield `yields` times, then either park until
+	// a producer wakes it up or keep yielding.
+	struct IdleStrategy
+	{
+		uint32_t spins  = 64;
+		uint32_t yields = 16;
+		bool     park   = true;
+
+		static constexpr uint32_t FOREVER = std::numeric_limits<uint32_t>::max();
+
+		static IdleStrategy BusySpin() { return { FOREVER, 0, false }; }
+		static IdleStrategy Yielding() { return { 0, FOREVER, false }; }
+		static IdleStrategy Blocking() { return { 0, 0, true }; }
+		static IdleStrategy Adaptive() { return {}; }
+	};
+
+	// Time between a producer waking a parked consumer and the consumer running again.
+	struct WakeLatency
+	{
+		uint64_t samples = 0;
+		uint64_t lastNs  = 0;
+		uint64_t maxNs   = 0;
+		uint64_t totalNs = 0;
+
+		uint64_t meanNs() const { return samples ? totalNs / samples : 0; }
+	};
+
+	// Futex-style wake signal built on std::atomic wait/notify.
+	// Producers only pay for a notify when the consumer is actually parked.
+	class Parker
+	{
+	public:
+		template<typename ReadyFunc>
+		void park(ReadyFunc ready)
+		{
+			const uint32_t seen = epoch.load(std::memory_order_acquire);
+			sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			if (!ready())
+			{
+				epoch.wait(seen, std::memory_order_acquire);
+
+				const uint64_t wokenAt = unparkedAt.load(std::memory_order_relaxed);
+				if (wokenAt != 0) record(timestamp() - wokenAt);
+			}
+
+			sleeping.store(false, std::memory_order_relaxed);
+		}
+
+		// Call after the message has been published to the queue.
+		void unpark()
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!sleeping.load(std::memory_order_relaxed)) return;
+
+			unparkedAt.store(timestamp(), std::memory_order_relaxed);
+			epoch.fetch_add(1, std::memory_order_release);
+			epoch.notify_one();
+		}
+
+		WakeLatency wakeLatency() const
+		{
+			return {
+				.samples = samples.load(std::memory_order_relaxed),
+				.lastNs  = lastNs.load(std::memory_order_relaxed),
+				.maxNs   = maxNs.load(std::memory_order_relaxed),
+				.totalNs = totalNs.load(std::memory_order_relaxed),
+			};
+		}
+
+	private:
+		static uint64_t timestamp()
+		{
+			auto now = std::chrono::steady_clock::now().time_since_epoch();
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+		}
+
+		void record(uint64_t latency)
+		{
+			// Only the parked consumer writes these
+			samples.store(samples.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			totalNs.store(totalNs.load(std::memory_order_relaxed) + latency, std::memory_order_relaxed);
+			lastNs.store(latency, std::memory_order_relaxed);
+			if (latency > maxNs.load(std::memory_order_relaxed))
+				maxNs.store(latency, std::memory_order_relaxed);
+		}
+
+		alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> epoch = 0;
+		std::atomic<bool>     sleeping = false;
+		std::atomic<uint64_t> unparkedAt = 0;
+
+		alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> samples = 0;
+		std::atomic<uint64_t> lastNs = 0;
+		std::atomic<uint64_t> maxNs = 0;
+		std::atomic<uint64_t> totalNs = 0;
+	};
+
+	// Consumer side state machine that applies an IdleStrategy one empty poll at a time.
+	class Idler
+	{
+	public:
+		Idler(const IdleStrategy& strategy, Parker& parker) : strategy(strategy), parker(parker) {}
+
+		template<typename ReadyFunc>
+		void idle(ReadyFunc ready)
+		{
+			if (count < strategy.spins)
+			{
+				CpuRelax();
+				++count;
+			}
+			else if (count - strategy.spins < strategy.yields)
+			{
+				std::this_thread::yield();
+				++count;
+			}
+			else if (strategy.park)
+			{
+				parker.park(ready);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		void reset() { count = 0; }
+
+	private:
+		IdleStrategy strategy;
+		Parker&      parker;
+		uint32_t     count = 0;
+	};
+}
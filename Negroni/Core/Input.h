@@ -21,6 +21,9 @@ namespace Core
         r32 mouseScrollDelta = 0;
 
         bool keysInUse[KEYS_IN_USE_LENGTH];
+        // Edges since the previous event, so a key pressed and released in between is not lost
+        bool keysPressed[KEYS_IN_USE_LENGTH];
+        bool keysReleased[KEYS_IN_USE_LENGTH];
 
         // To know if there were any user input done
         bool isDirty = false;
@@ -58,6 +61,8 @@ namespace Core
                 input.mousePositionDeltaX = 0;
                 input.mousePositionDeltaY = 0;
                 input.mouseScrollDelta = 0;
+                memset(input.keysPressed, 0, sizeof(input.keysPressed));
+                memset(input.keysReleased, 0, sizeof(input.keysReleased));
                 input.isDirty = false;
             }
 
@@ -102,7 +107,24 @@ namespace Core
 
             u8 keyCode = actionCodeMap[actionName];
 
-            return input.keysInUse[keyCode];
+            // A key tapped within one frame counts as down for that frame
+            return input.keysInUse[keyCode] || input.keysPressed[keyCode];
+        }
+
+        static bool WasPressed(const str& actionName)
+        {
+            if (!actionCodeMap.contains(actionName))
+                return false;
+
+            return input.keysPressed[actionCodeMap[actionName]];
+        }
+
+        static bool WasReleased(const str& actionName)
+        {
+            if (!actionCodeMap.contains(actionName))
+                return false;
+
+            return input.keysReleased[actionCodeMap[actionName]];
         }
 
         inline static bool isKeyboardBlocked = false;
@@ -0,0 +1,322 @@
+#include "JobSystem.h"
+#include "IdleStrategy.h"
+#include "Metrics.h"
+#include "MpmcQueue.h"
+#include "Profiler.h"
+
+#include <cassert>
+#include <thread>
+
+namespace Core
+{
+    constexpr u32 JOB_DEQUE_SIZE = 4096;
+    constexpr u32 JOB_POOL_SIZE = 4096;
+
+    // A submitted copy of a job. busy is set by the submitting thread and cleared by
+    // whichever thread ran the job, so it is read and written across threads.
+    struct QueuedJob
+    {
+        Job               job;
+        std::atomic<bool> busy = false;
+    };
+
+    // Chase-Lev work-stealing deque. The owner pushes and pops at the bottom,
+    // thieves take from the top.
+    class JobSystem::Worker
+    {
+    public:
+        bool Push(QueuedJob* job)
+        {
+            i64 b = bottom.load(std::memory_order_relaxed);
+            i64 t = top.load(std::memory_order_acquire);
+            if (b - t >= (i64)JOB_DEQUE_SIZE) return false;
+
+            jobs[b & (JOB_DEQUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        QueuedJob* Pop()
+        {
+            i64 b = bottom.load(std::memory_order_relaxed) - 1;
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            i64 t = top.load(std::memory_order_relaxed);
+
+            if (t > b)
+            {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            QueuedJob* job = jobs[b & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+            if (t == b)
+            {
+                // Last job, race against thieves for it
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    job = nullptr;
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return job;
+        }
+
+        QueuedJob* Steal()
+        {
+            i64 t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            i64 b = bottom.load(std::memory_order_acquire);
+            if (t >= b) return nullptr;
+
+            QueuedJob* job = jobs[t & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+            return job;
+        }
+
+        bool Empty() const
+        {
+            return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+        }
+
+        // Approximate while other threads push or steal
+        u32 Size() const
+        {
+            return (u32)std::max<i64>(0, bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_relaxed));
+        }
+
+        std::thread thread;
+        Parker      parker;
+
+        // Jobs this worker ran, only it writes, JobSystem::Frame() reads
+        alignas(CACHE_LINE_SIZE) std::atomic<u64> executed = 0;
+
+    private:
+        alignas(CACHE_LINE_SIZE) std::atomic<i64> top = 0;
+        alignas(CACHE_LINE_SIZE) std::atomic<i64> bottom = 0;
+        alignas(CACHE_LINE_SIZE) std::atomic<QueuedJob*> jobs[JOB_DEQUE_SIZE];
+    };
+
+    std::vector<Scope<JobSystem::Worker>> JobSystem::workers;
+    static MpmcQueue<QueuedJob*, JOB_DEQUE_SIZE> injected;
+    static std::atomic<bool> running = false;
+    // Jobs run by threads that are not workers while they wait, and by workers already stopped
+    static std::atomic<u64> externalExecuted = 0;
+
+    // -1 on threads that are not workers
+    static thread_local i32 workerIndex = -1;
+
+    // Jobs are copied into a per-thread ring, so submitting one only allocates the first time.
+    // A slot is reused after JOB_POOL_SIZE submissions from the same thread.
+    // Allocated by the first Run() of a thread, threads that never submit a job pay nothing.
+    struct JobPool
+    {
+        QueuedJob* jobs = nullptr;
+        u32 next = 0;
+
+        ~JobPool()
+        {
+            if (!jobs) return;
+
+            // A job still queued points into the pool, it is left to the job when it never ran
+            for (u32 i = 0; i < JOB_POOL_SIZE; ++i)
+                if (jobs[i].busy.load(std::memory_order_acquire)) return;
+            delete[] jobs;
+        }
+    };
+
+    static thread_local JobPool jobPool;
+
+    // Null when the next slot still holds a job that has not run yet
+    static QueuedJob* AllocateJob(const Job& job)
+    {
+        if (!jobPool.jobs) jobPool.jobs = new QueuedJob[JOB_POOL_SIZE];
+
+        QueuedJob* slot = &jobPool.jobs[jobPool.next & (JOB_POOL_SIZE - 1)];
+        if (slot->busy.load(std::memory_order_acquire)) return nullptr;
+
+        jobPool.next++;
+        slot->job = job;
+        slot->busy.store(true, std::memory_order_relaxed);
+        return slot;
+    }
+
+    static void RunInline(const Job& job)
+    {
+        job.function(job.data, job.begin, job.end);
+        if (job.counter) job.counter->value.fetch_sub(1, std::memory_order_release);
+    }
+
+    void JobSystem::Start(u32 numWorkers)
+    {
+        assert(workers.empty());
+
+        running = true;
+        workers.reserve(numWorkers);
+        for (u32 i = 0; i < numWorkers; ++i)
+        {
+            workers.push_back(MakeScope<Worker>());
+        }
+        for (u32 i = 0; i < numWorkers; ++i)
+        {
+            workers[i]->thread = std::thread(WorkerMain, i);
+        }
+
+        log_info("started {} workers", numWorkers);
+    }
+
+    void JobSystem::Stop()
+    {
+        running = false;
+        for (auto& worker : workers)
+        {
+            worker->parker.unpark();
+        }
+        for (auto& worker : workers)
+        {
+            if (worker->thread.joinable()) worker->thread.join();
+            externalExecuted.fetch_add(worker->executed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        workers.clear();
+    }
+
+    u32 JobSystem::WorkerCount()
+    {
+        return (u32)workers.size();
+    }
+
+    void JobSystem::Frame()
+    {
+        static MetricCounter& jobsRun = Metrics::Counter("Jobs/Executed");
+        static MetricGauge& queuedJobs = Metrics::Gauge("Jobs/Queued");
+        static u64 lastExecuted = 0;
+
+        // Summed here once per frame, so running a job never touches a shared counter
+        u64 executed = externalExecuted.load(std::memory_order_relaxed);
+        for (auto& worker : workers) executed += worker->executed.load(std::memory_order_relaxed);
+        jobsRun.Add((i64)(executed - lastExecuted));
+        lastExecuted = executed;
+
+        // The backlog at the end of the frame, approximate while workers keep stealing
+        u32 queued = (u32)injected.size();
+        for (auto& worker : workers) queued += worker->Size();
+        queuedJobs.Set(queued);
+    }
+
+    void JobSystem::Run(const Job& job)
+    {
+        Run(&job, 1);
+    }
+
+    void JobSystem::Run(const Job* jobs, u32 count)
+    {
+        for (u32 i = 0; i < count; ++i)
+        {
+            if (jobs[i].counter) jobs[i].counter->value.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        for (u32 i = 0; i < count; ++i)
+        {
+            QueuedJob* job = AllocateJob(jobs[i]);
+            if (!job)
+            {
+                // Too many unfinished jobs from this thread, run it right here
+                RunInline(jobs[i]);
+                continue;
+            }
+
+            bool pushed = workerIndex >= 0 ? workers[workerIndex]->Push(job) : injected.trySend(job);
+            if (!pushed)
+            {
+                // Queue is full, run it right here
+                job->busy.store(false, std::memory_order_relaxed);
+                RunInline(jobs[i]);
+            }
+        }
+
+        for (auto& worker : workers)
+        {
+            worker->parker.unpark();
+        }
+    }
+
+    void JobSystem::Wait(JobCounter& counter)
+    {
+        Backoff backoff;
+        while (!counter.Done())
+        {
+            if (Execute())
+                backoff.reset();
+            else
+                backoff.pause();
+        }
+    }
+
+    // Runs one job from the own deque, the injection queue or another worker.
+    bool JobSystem::Execute()
+    {
+        QueuedJob* job = nullptr;
+
+        if (workerIndex >= 0)
+            job = workers[workerIndex]->Pop();
+
+        if (!job)
+            injected.tryReceive(job);
+
+        if (!job && !workers.empty())
+        {
+            static thread_local u32 victim = 0;
+            for (u32 i = 0; i < workers.size() && !job; ++i)
+            {
+                victim = (victim + 1) % workers.size();
+                if ((i32)victim != workerIndex) job = workers[victim]->Steal();
+            }
+        }
+
+        if (!job) return false;
+
+        if (workerIndex >= 0)
+        {
+            // Single writer, a plain increment without a locked instruction
+            std::atomic<u64>& executed = workers[workerIndex]->executed;
+            executed.store(executed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        else
+        {
+            externalExecuted.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Copied out, the slot may be reused by its owner as soon as busy is cleared
+        Job run = job->job;
+        {
+            ProfileBlock("[JobSystem] Job");
+            run.function(run.data, run.begin, run.end);
+        }
+        job->busy.store(false, std::memory_order_release);
+        if (run.counter) run.counter->value.fetch_sub(1, std::memory_order_release);
+
+        return true;
+    }
+
+    void JobSystem::WorkerMain(u32 index)
+    {
+        workerIndex = index;
+        ProfileThread(std::format("Worker {}", index).c_str());
+
+        Idler idler(IdleStrategy::Adaptive(), workers[index]->parker);
+        auto hasWork = [] {
+            if (!injected.empty()) return true;
+            for (auto& worker : workers)
+                if (!worker->Empty()) return true;
+            return !running.load();
+        };
+
+        while (running.load(std::memory_order_relaxed))
+        {
+            if (Execute())
+                idler.reset();
+            else
+                idler.idle(hasWork);
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Base.h"
+
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+
+namespace Core
+{
+    typedef void (*JobFunction)(void* data, u32 begin, u32 end);
+
+    // Number of unfinished jobs attached to it. A job that must run after others
+    // waits on their counter, so counters double as dependencies.
+    struct JobCounter
+    {
+        std::atomic<u32> value = 0;
+
+        bool Done() const { return value.load(std::memory_order_acquire) == 0; }
+    };
+
+    struct Job
+    {
+        JobFunction function = nullptr;
+        void*       data = nullptr;
+        u32         begin = 0;
+        u32         end = 0;
+        JobCounter* counter = nullptr;
+    };
+
+    // Fixed pool of workers, each with its own work-stealing deque.
+    // Jobs submitted from a worker go to its own deque, jobs from any other thread
+    // go to a shared injection queue. Idle workers steal from each other and park.
+    class JobSystem
+    {
+    public:
+        static void Start(u32 numWorkers);
+        static void Stop();
+        static u32 WorkerCount();
+
+        // Feeds the Jobs/* metrics, call right before Metrics::Sample()
+        static void Frame();
+
+        static void Run(const Job& job);
+        static void Run(const Job* jobs, u32 count);
+
+        // Executes other jobs on the calling thread until the counter reaches zero.
+        static void Wait(JobCounter& counter);
+
+        // Calls func(index) for every index in [0, count), in chunks of grainSize indices.
+        // Runs inline when there are no workers or the range fits in one chunk.
+        template<typename Func>
+        static void ParallelFor(u32 count, u32 grainSize, Func&& func)
+        {
+            typedef std::remove_reference_t<Func> FuncType;
+
+            if (count == 0) return;
+            grainSize = std::max(grainSize, 1u);
+
+            if (WorkerCount() == 0 || count <= grainSize)
+            {
+                for (u32 i = 0; i < count; ++i) func(i);
+                return;
+            }
+
+            JobFunction body = [](void* data, u32 begin, u32 end) {
+                FuncType& f = *(FuncType*)data;
+                for (u32 i = begin; i < end; ++i) f(i);
+            };
+
+            constexpr u32 BATCH_SIZE = 64;
+            Job batch[BATCH_SIZE];
+            JobCounter counter;
+
+            u32 batchSize = 0;
+            for (u32 begin = 0; begin < count; begin += grainSize)
+            {
+                batch[batchSize++] = { body, (void*)&func, begin, std::min(begin + grainSize, count), &counter };
+                if (batchSize == BATCH_SIZE)
+                {
+                    Run(batch, batchSize);
+                    batchSize = 0;
+                }
+            }
+            if (batchSize) Run(batch, batchSize);
+
+            Wait(counter);
+        }
+
+    private:
+        class Worker;
+
+        static std::vector<Scope<Worker>> workers;
+
+        static bool Execute();
+        static void WorkerMain(u32 index);
+    };
+}
@@ -110,7 +110,8 @@ namespace Core
             {"J", 74},
             {"Space", 32},
             {"Escape", 27},
-            {"Tilde", 192}
+            {"Tilde", 192},
+            {"F9", 120}
         };
     };
 }
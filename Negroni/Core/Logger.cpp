@@ -1,55 +1,377 @@
 #include "Logger.h"
-#include <sstream>
+#include "IdleStrategy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <vector>
 
 namespace Core
 {
-	struct LoggerQItem
+	constexpr uint32_t LOG_MAX_THREADS = 256;
+	// How often the logger thread looks for closed LOG_THROTTLED windows while any has dropped calls
+	constexpr auto LOG_SUPPRESSED_POLL = std::chrono::milliseconds(100);
+
+	enum class LogBufferState : uint32_t
 	{
-		bool quit = false;
-		std::string threadTag;
-		std::string message;
+		Owned,		// Written by a live thread
+		Released,	// Its thread exited, the logger thread still has to drain it
+		Free,		// Drained, the next thread that logs takes it over
 	};
 
-	Queue<LoggerQItem> loggerQueue = Queue<LoggerQItem>();
-	std::thread loggerThread;
+	// Single producer (the owning thread), single consumer (the logger thread) ring of records.
+	// A record never wraps around: when it does not fit before the end, the rest of the
+	// buffer is skipped as padding.
+	class LogBuffer
+	{
+	public:
+		char* reserve(uint32_t size)
+		{
+			uint64_t head = this->head.load(std::memory_order_relaxed);
+			uint32_t position = head % LOG_BUFFER_SIZE;
+			uint32_t padding = LOG_BUFFER_SIZE - position < size ? LOG_BUFFER_SIZE - position : 0;
+
+			if (head + padding + size - cachedTail > LOG_BUFFER_SIZE && !waitForSpace(head + padding + size))
+			{
+				return nullptr;
+			}
+
+			if (padding >= sizeof(LogRecord))
+			{
+				LogRecord& record = *(LogRecord*)(data + position);
+				record.size = padding;
+				record.decode = nullptr;
+			}
+
+			pending = head + padding + size;
+			return data + (head + padding) % LOG_BUFFER_SIZE;
+		}
+
+		void commit()
+		{
+			head.store(pending, std::memory_order_release);
+		}
+
+		// Consumer side, calls func(record) for everything committed so far
+		template<typename Func>
+		size_t drain(Func func)
+		{
+			uint64_t tail = this->tail.load(std::memory_order_relaxed);
+			uint64_t head = this->head.load(std::memory_order_acquire);
+			size_t count = 0;
+
+			while (tail < head)
+			{
+				uint32_t position = tail % LOG_BUFFER_SIZE;
+				if (LOG_BUFFER_SIZE - position < sizeof(LogRecord))
+				{
+					tail += LOG_BUFFER_SIZE - position;
+					continue;
+				}
+
+				const LogRecord& record = *(const LogRecord*)(data + position);
+				if (record.decode)
+				{
+					func(record);
+					++count;
+				}
+				tail += record.size;
+			}
+
+			this->tail.store(tail, std::memory_order_release);
+			return count;
+		}
+
+		bool empty() const
+		{
+			return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+		}
+
+		std::atomic<LogBufferState> state = LogBufferState::Owned;
+
+	private:
+		bool waitForSpace(uint64_t end);
+
+		alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head = 0;
+		uint64_t cachedTail = 0;
+		uint64_t pending = 0;
+
+		alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail = 0;
+
+		alignas(CACHE_LINE_SIZE) char data[LOG_BUFFER_SIZE];
+	};
 
-	static void loggerFunc(Queue<LoggerQItem>& in)
+	struct LogLine
 	{
-		std::ostringstream id;
-		id << std::this_thread::get_id();
-		std::string threadTag = std::format("(TID={}) ", id.str());
+		uint64_t       timestamp;
+		const LogSite* site;
+		std::string    message;
+	};
+
+	static std::atomic<LogBuffer*> logBuffers[LOG_MAX_THREADS];
+	static std::atomic<uint32_t> logBufferCount = 0;
+	static thread_local LogBuffer* threadLogBuffer = nullptr;
+	static thread_local bool threadRegistered = false;
+
+	static std::thread loggerThread;
+	static std::once_flag loggerStarted;
+	static std::atomic<bool> loggerRunning = false;
+	static std::atomic<bool> loggerQuit = false;
+	static Parker loggerParker;
+	static std::atomic<bool> loggerSuppressed = false;
+
+	// Used when there is no logger thread to hand records to
+	static std::mutex syncMutex;
+	static thread_local std::vector<char> syncRecord;
+	static thread_local bool syncReserved = false;
 
-		std::cout << threadTag << "[Logger] started" << std::endl;
+	static const char* levelName(LogLevel level)
+	{
+		switch (level)
+		{
+		case LogLevel::Debug: return CONSOLE_COLOR_MAGENTA "Debug:" CONSOLE_COLOR_RESET;
+		case LogLevel::Info:  return CONSOLE_COLOR_CYAN "Info" CONSOLE_COLOR_RESET;
+		case LogLevel::Warn:  return CONSOLE_COLOR_YELLOW "Warn" CONSOLE_COLOR_RESET;
+		case LogLevel::Error: return CONSOLE_COLOR_RED "Error" CONSOLE_COLOR_RESET;
+		}
+		return "";
+	}
+
+	static void writeLine(std::string& out, const LogSite& site, std::string_view message)
+	{
+		std::format_to(std::back_inserter(out), "[{}] {} {}\n", site.location, levelName(site.level), message);
+	}
+
+	// Returns false when the logger stops before there is space
+	bool LogBuffer::waitForSpace(uint64_t end)
+	{
+		Backoff backoff;
 		while (true)
 		{
-			LoggerQItem qItem;
-			in.receive(std::ref(qItem));
-			if (qItem.quit) break;
-			std::cout << qItem.threadTag << qItem.message << std::endl;
+			cachedTail = tail.load(std::memory_order_acquire);
+			if (end - cachedTail <= LOG_BUFFER_SIZE) return true;
+			if (!loggerRunning.load(std::memory_order_acquire)) return false;
+
+			loggerParker.unpark();
+			backoff.pause();
 		}
-		std::cout << threadTag << "[Logger] stopped" << std::endl;
 	}
 
-	void startLogger()
+	void logSuppressionPending()
 	{
-		loggerThread = std::thread(loggerFunc, std::ref(loggerQueue));
+		if (!loggerSuppressed.exchange(true, std::memory_order_release)) loggerParker.unpark();
 	}
 
-	void log(std::string message)
+	// Adds a summary line for every throttled call site whose dropped calls nobody reported,
+	// force reports the open windows too
+	static void flushSuppressed(bool force, std::vector<LogLine>& lines, size_t& used)
 	{
-		std::ostringstream id;
-		id << std::this_thread::get_id();
-		std::string threadTag = std::format("(TID={}) ", id.str());
+		if (!loggerSuppressed.exchange(false, std::memory_order_acquire) && !force) return;
+
+		uint64_t now = Clock::nanos();
+		bool waiting = false;
+		for (LogLimiter* limiter = LogLimiter::First(); limiter; limiter = limiter->Next())
+		{
+			LogLimiter::Suppressed suppressed;
+			if (!limiter->takeSuppressed(now, force, suppressed, waiting)) continue;
+
+			if (used == lines.size()) lines.emplace_back();
+			LogLine& line = lines[used++];
+			line.timestamp = now;
+			line.site = &limiter->site;
+			line.message = std::format(LOG_SUPPRESSED_FORMAT, suppressed.count, suppressed.nanos / 1e9);
+
+			if (FlightRecorder::Enabled())
+				FlightRecorder::Write(limiter->site, limiter->summarySiteId, LOG_SUPPRESSED_FORMAT, now, suppressed.count, suppressed.nanos / 1e9);
+		}
 
-		loggerQueue.send({ false, threadTag, message });
+		if (waiting) loggerSuppressed.store(true, std::memory_order_relaxed);
+	}
+
+	static LogBuffer* registerThread()
+	{
+		// The buffers of exited threads first, head and tail carry on where they were
+		uint32_t used = std::min(logBufferCount.load(std::memory_order_acquire), LOG_MAX_THREADS);
+		for (uint32_t i = 0; i < used; ++i)
+		{
+			LogBuffer* buffer = logBuffers[i].load(std::memory_order_acquire);
+			LogBufferState free = LogBufferState::Free;
+			if (buffer && buffer->state.compare_exchange_strong(free, LogBufferState::Owned, std::memory_order_acquire))
+				return buffer;
+		}
+
+		uint32_t index = logBufferCount.fetch_add(1, std::memory_order_relaxed);
+		if (index >= LOG_MAX_THREADS) return nullptr;
+
+		LogBuffer* buffer = new LogBuffer();
+		logBuffers[index].store(buffer, std::memory_order_release);
+		return buffer;
+	}
+
+	static void loggerFunc()
+	{
+		std::vector<LogLine> lines;
+		std::vector<LogLine*> order;
+		size_t used = 0;
+		std::string out;
+
+		Idler idler(IdleStrategy::Adaptive(), loggerParker);
+		auto pending = [] {
+			if (loggerQuit.load(std::memory_order_acquire)) return true;
+			if (loggerSuppressed.load(std::memory_order_relaxed)) return true;
+
+			uint32_t count = std::min(logBufferCount.load(std::memory_order_acquire), LOG_MAX_THREADS);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				LogBuffer* buffer = logBuffers[i].load(std::memory_order_acquire);
+				if (buffer && !buffer->empty()) return true;
+			}
+			return false;
+		};
+
+		while (true)
+		{
+			// Read quit first, so the last drain sees everything logged before stopLogger()
+			bool quit = loggerQuit.load(std::memory_order_acquire);
+
+			used = 0;
+			uint32_t count = std::min(logBufferCount.load(std::memory_order_acquire), LOG_MAX_THREADS);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				LogBuffer* buffer = logBuffers[i].load(std::memory_order_acquire);
+				if (!buffer) continue;
+
+				// Released after the last commit of its thread, so this drain empties it
+				bool released = buffer->state.load(std::memory_order_acquire) == LogBufferState::Released;
+
+				buffer->drain([&](const LogRecord& record) {
+					if (used == lines.size()) lines.emplace_back();
+					LogLine& line = lines[used++];
+					line.timestamp = record.timestamp;
+					line.site = record.site;
+					line.message.clear();
+					record.decode(std::string_view(record.format, record.formatSize), (const char*)(&record + 1), line.message);
+				});
+
+				if (released) buffer->state.store(LogBufferState::Free, std::memory_order_release);
+			}
+
+			flushSuppressed(quit, lines, used);
+
+			if (used == 0)
+			{
+				if (quit) break;
+
+				// The idler parks without a timeout, a dropped count waits for its window to close
+				if (loggerSuppressed.load(std::memory_order_relaxed))
+					std::this_thread::sleep_for(LOG_SUPPRESSED_POLL);
+				else
+					idler.idle(pending);
+				continue;
+			}
+
+			idler.reset();
+
+			// Threads are drained one after another, put their lines back in time order
+			order.resize(used);
+			for (size_t i = 0; i < used; ++i) order[i] = &lines[i];
+			std::stable_sort(order.begin(), order.end(), [](const LogLine* a, const LogLine* b) { return a->timestamp < b->timestamp; });
+
+			out.clear();
+			for (const LogLine* line : order)
+			{
+				writeLine(out, *line->site, line->message);
+			}
+			std::cout.write(out.data(), out.size());
+			std::cout.flush();
+		}
+	}
+
+	void startLogger()
+	{
+		std::call_once(loggerStarted, [] {
+			loggerRunning.store(true, std::memory_order_release);
+			loggerThread = std::thread(loggerFunc);
+		});
 	}
 
 	void stopLogger()
 	{
-		loggerQueue.send({ true });
+		// A logger that never started must not start later either
+		std::call_once(loggerStarted, [] {});
+		if (!loggerRunning.exchange(false, std::memory_order_acq_rel)) return;
+
+		loggerQuit.store(true, std::memory_order_release);
+		loggerParker.unpark();
 		if (loggerThread.joinable())
 		{
 			loggerThread.join();
 		}
 	}
+
+	char* logReserve(uint32_t size)
+	{
+		if (!threadRegistered)
+		{
+			// Hands the buffer back when the thread exits, later log calls of the thread are synchronous
+			static thread_local struct LogThreadExit
+			{
+				~LogThreadExit()
+				{
+					if (threadLogBuffer) threadLogBuffer->state.store(LogBufferState::Released, std::memory_order_release);
+					threadLogBuffer = nullptr;
+				}
+			} threadExit;
+
+			threadRegistered = true;
+			startLogger();
+			threadLogBuffer = registerThread();
+		}
+
+		char* record = nullptr;
+		if (threadLogBuffer && loggerRunning.load(std::memory_order_acquire))
+		{
+			record = threadLogBuffer->reserve(size);
+		}
+
+		if (!record)
+		{
+			syncReserved = true;
+			syncRecord.resize(std::max<size_t>(size, syncRecord.size()));
+			record = syncRecord.data();
+		}
+
+		return record;
+	}
+
+	void logCommit()
+	{
+		if (syncReserved)
+		{
+			syncReserved = false;
+
+			const LogRecord& record = *(const LogRecord*)syncRecord.data();
+			std::string message;
+			record.decode(std::string_view(record.format, record.formatSize), (const char*)(&record + 1), message);
+
+			std::string out;
+			writeLine(out, *record.site, message);
+
+			std::lock_guard<std::mutex> guard(syncMutex);
+			std::cout.write(out.data(), out.size());
+			std::cout.flush();
+			return;
+		}
+
+		threadLogBuffer->commit();
+		loggerParker.unpark();
+	}
+
+	// Flushes whatever is still buffered when the program exits
+	static struct LoggerShutdown
+	{
+		~LoggerShutdown() { stopLogger(); }
+	} loggerShutdown;
 }
@@ -1,9 +1,24 @@
 #pragma once
 
-#include "Queue.h"
-#include <iostream>
+#include "Clock.h"
+#include "FlightRecorder.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
 #include <format>
 #include <functional>
+#include <iterator>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 #ifdef _MSC_VER // Microsoft compilers
     #define GET_ARG_COUNT(...)  INTERNAL_EXPAND_ARGS_PRIVATE(INTERNAL_ARGS_AUGMENTER(__VA_ARGS__))
@@ -20,22 +35,19 @@ namespace Core
 {
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // Multithread logger part
+    //
+    // A log call does no formatting and no I/O. It copies the format string pointer and the raw
+    // arguments into a binary record in the calling thread's buffer. The logger thread collects
+    // the records of all threads, formats them in timestamp order and writes them in batches.
+    // While the FlightRecorder is open every record is also copied into its mapped file.
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-    extern struct LoggerQItem;
 
-    extern Queue<LoggerQItem> loggerQueue;
-    extern std::thread loggerThread;
+    enum class LogLevel : uint8_t { Debug, Info, Warn, Error };
 
-    extern void loggerFunc(Queue<LoggerQItem>& in);
-    extern void log(std::string message);
-    extern void startLogger();
-    extern void stopLogger();
-    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-    constexpr std::string logLocation(const std::string& prettyFunction)
+    constexpr std::string_view logLocation(std::string_view prettyFunction)
     {
         size_t colons = prettyFunction.find("(");
-        if (colons == std::string::npos) return "";
+        if (colons == std::string_view::npos) return "";
         // size_t begin = prettyFunction.substr(0, colons).rfind(" ") + 1; // Including namespace
         //size_t begin = prettyFunction.find("::") + 2; // Excluding namespace
         size_t begin = prettyFunction.rfind("::", prettyFunction.rfind("::", colons) - 1) + 2; // Excluding namespace. Fixed.
@@ -44,11 +56,365 @@ namespace Core
         return prettyFunction.substr(begin, end);
     }
 
-#if defined(_MSC_VER)
-    #define __PRETTY_FUNCTION__     __FUNCSIG__
+    // Everything known about a log call at compile time, one static instance per call site
+    struct LogSite
+    {
+        LogLevel         level;
+        std::string_view location;  // Class::Method part of the function name
+        const char*      function;
+        const char*      file;
+        uint32_t         line;
+    };
+
+    constexpr LogSite logSite(LogLevel level, const std::source_location& where)
+    {
+        return { level, logLocation(where.function_name()), where.function_name(), where.file_name(), where.line() };
+    }
+
+    // Calls below this level are skipped before their arguments are evaluated
+#if defined(DEBUG)
+    inline std::atomic<LogLevel> logThreshold = LogLevel::Debug;
+#else
+    inline std::atomic<LogLevel> logThreshold = LogLevel::Info;
 #endif
 
-#define __LOG_LOCATION__    logLocation(__PRETTY_FUNCTION__)
+    inline bool logEnabled(LogLevel level)
+    {
+        return level >= logThreshold.load(std::memory_order_relaxed);
+    }
+
+    // Rebuilds the arguments from a record and appends the formatted message to out
+    typedef void (*LogDecodeFunc)(std::string_view format, const char* data, std::string& out);
+
+    // Header of a record in a thread's log buffer, the encoded arguments follow it
+    struct LogRecord
+    {
+        uint32_t       size;        // Header and arguments, a multiple of 8
+        uint32_t       formatSize;
+        const char*    format;      // The format string literal, doubles as the message id
+        const LogSite* site;
+        LogDecodeFunc  decode;      // nullptr for the padding in front of a wrap around
+        uint64_t       timestamp;
+    };
+
+    constexpr uint32_t LOG_BUFFER_SIZE = 64 * 1024;
+    constexpr uint32_t LOG_MAX_RECORD  = LOG_BUFFER_SIZE / 4;
+
+    // Space for one record in the calling thread's buffer, waits while the buffer is full
+    extern char* logReserve(uint32_t size);
+    // Hands the record written into the reserved space to the logger thread
+    extern void logCommit();
+
+    extern void startLogger();
+    // Writes out everything logged so far. Later log calls are written synchronously.
+    extern void stopLogger();
+
+    // Numbers, enums, void pointers and the types marked LogCopyable are stored as raw bytes,
+    // strings as length and characters. Anything else, which may point at memory gone by the
+    // time the logger thread formats it, is formatted on the calling thread with the spec of
+    // its replacement field and stored as text that is copied into the message as is.
+    struct LogFormatted
+    {
+        std::string text;
+    };
+
+    struct LogFormattedView
+    {
+        std::string_view text;
+    };
+
+    // The spec of the first replacement field that refers to argument index, "" when it has none.
+    // Format strings are checked at compile time, so this only has to walk a valid one.
+    constexpr std::string_view logFieldSpec(std::string_view format, size_t index)
+    {
+        size_t nextIndex = 0;
+        for (size_t i = 0; i < format.size(); ++i)
+        {
+            if (format[i] != '{') continue;
+            if (i + 1 < format.size() && format[i + 1] == '{')
+            {
+                ++i;
+                continue;
+            }
+
+            size_t idEnd = format.find_first_of(":}", i + 1);
+            if (idEnd == std::string_view::npos) break;
+
+            size_t id = 0;
+            if (idEnd == i + 1)
+                id = nextIndex++;
+            else
+                for (size_t d = i + 1; d < idEnd; ++d) id = id * 10 + (format[d] - '0');
+
+            // The spec runs to the closing brace, nested fields for a dynamic width included
+            size_t end = idEnd;
+            for (int depth = 1; end < format.size(); ++end)
+            {
+                if (format[end] == '{')
+                {
+                    ++depth;
+                    if (end + 1 < format.size() && format[end + 1] == '}') ++nextIndex;
+                }
+                else if (format[end] == '}' && --depth == 0) break;
+            }
+
+            if (id == index) return format[idEnd] == ':' ? format.substr(idEnd + 1, end - idEnd - 1) : "";
+            i = end;
+        }
+        return "";
+    }
+
+    template<typename T>
+    LogFormatted logFormatArg(const T& arg, std::string_view format, size_t index)
+    {
+        std::string_view spec = logFieldSpec(format, index);
+
+        // A dynamic width or precision needs the other arguments, it is left out here
+        if (spec.empty() || spec.find('{') != std::string_view::npos) return { std::format("{}", arg) };
+
+        std::string field = "{:";
+        field.append(spec);
+        field.push_back('}');
+        return { std::vformat(field, std::make_format_args(arg)) };
+    }
+
+    template<typename T>
+    constexpr bool LogIsString = std::is_same_v<T, const char*> || std::is_same_v<T, char*> ||
+                                 std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>;
+
+    // Specialized to true for plain value types that own everything they format, like Vec3f
+    template<typename T>
+    constexpr bool LogCopyable = false;
+
+    template<typename T>
+    constexpr bool LogIsRaw = std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_same_v<T, std::nullptr_t> ||
+                              std::is_same_v<T, void*> || std::is_same_v<T, const void*> || LogCopyable<T>;
+
+    template<typename T>
+    using LogStored = std::conditional_t<LogIsRaw<std::decay_t<T>>, std::decay_t<T>,
+                      std::conditional_t<LogIsString<std::decay_t<T>>, std::string_view, LogFormattedView>>;
+
+    template<typename T>
+    decltype(auto) logPrepare(const T& arg, std::string_view format, size_t index)
+    {
+        typedef std::decay_t<T> Type;
+
+        if constexpr (LogIsRaw<Type>) return (arg);
+        else if constexpr (std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>) return std::string_view(arg ? arg : "(null)");
+        else if constexpr (LogIsString<Type>) return std::string_view(arg);
+        else return logFormatArg(arg, format, index);
+    }
+
+    template<typename T>
+    std::string_view logArgText(const T& arg)
+    {
+        if constexpr (std::is_same_v<T, LogFormatted>) return arg.text;
+        else return arg;
+    }
+
+    template<typename T>
+    constexpr bool LogIsText = std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string> || std::is_same_v<T, LogFormatted>;
+
+    template<typename T>
+    uint32_t logArgSize(const T& arg)
+    {
+        if constexpr (LogIsText<T>) return sizeof(uint32_t) + (uint32_t)logArgText(arg).size();
+        else return sizeof(T);
+    }
+
+    template<typename T>
+    char* logArgWrite(char* cursor, const T& arg)
+    {
+        if constexpr (LogIsText<T>)
+        {
+            std::string_view text = logArgText(arg);
+            uint32_t size = (uint32_t)text.size();
+            memcpy(cursor, &size, sizeof(size));
+            memcpy(cursor + sizeof(size), text.data(), size);
+            return cursor + sizeof(size) + size;
+        }
+        else
+        {
+            memcpy(cursor, &arg, sizeof(T));
+            return cursor + sizeof(T);
+        }
+    }
+
+    template<typename T>
+    T logArgRead(const char*& cursor)
+    {
+        if constexpr (std::is_same_v<T, std::string_view>)
+        {
+            uint32_t size;
+            memcpy(&size, cursor, sizeof(size));
+            std::string_view value(cursor + sizeof(size), size);
+            cursor += sizeof(size) + size;
+            return value;
+        }
+        else if constexpr (std::is_same_v<T, LogFormattedView>)
+        {
+            return { logArgRead<std::string_view>(cursor) };
+        }
+        else
+        {
+            std::array<char, sizeof(T)> bytes;
+            memcpy(bytes.data(), cursor, sizeof(T));
+            cursor += sizeof(T);
+            return std::bit_cast<T>(bytes);
+        }
+    }
+
+    template<typename... Stored>
+    void logDecode(std::string_view format, const char* data, std::string& out)
+    {
+        // Braced initialization reads the arguments in order
+        std::tuple<Stored...> values{ logArgRead<Stored>(data)... };
+
+        // Runs on the logger thread, a bad record must not take it down
+        size_t start = out.size();
+        try
+        {
+            std::apply([&](auto&... value) {
+                std::vformat_to(std::back_inserter(out), format, std::make_format_args(value...));
+            }, values);
+        }
+        catch (const std::format_error& error)
+        {
+            out.resize(start);
+            std::format_to(std::back_inserter(out), "{} (format error: {})", format, error.what());
+        }
+    }
+
+    template<typename... Prepared>
+    void logEncode(const LogSite& site, std::string_view format, LogDecodeFunc decode, uint64_t timestamp, const Prepared&... args)
+    {
+        uint32_t size = (uint32_t)sizeof(LogRecord) + (0 + ... + logArgSize(args));
+        if (size > LOG_MAX_RECORD)
+        {
+            // Too big for the buffer, format it here and keep what fits
+            std::string message = std::vformat(format, std::make_format_args(args...));
+            message.resize(std::min<size_t>(message.size(), LOG_MAX_RECORD - sizeof(LogRecord) - sizeof(uint32_t)));
+            logEncode(site, "{}", &logDecode<std::string_view>, timestamp, std::string_view(message));
+            return;
+        }
+        size = (size + 7) & ~7u;
+
+        char* cursor = logReserve(size);
+        *(LogRecord*)cursor = {
+            .size       = size,
+            .formatSize = (uint32_t)format.size(),
+            .format     = format.data(),
+            .site       = &site,
+            .decode     = decode,
+            .timestamp  = timestamp,
+        };
+        cursor += sizeof(LogRecord);
+        ((cursor = logArgWrite(cursor, args)), ...);
+        logCommit();
+    }
+
+    template<typename... Prepared>
+    void logDispatch(const LogSite& site, LogSiteId& siteId, std::string_view format, LogDecodeFunc decode, const Prepared&... args)
+    {
+        uint64_t timestamp = Clock::nanos();
+        if (FlightRecorder::Enabled()) FlightRecorder::Write(site, siteId, format, timestamp, args...);
+        logEncode(site, format, decode, timestamp, args...);
+    }
+
+    template<typename... Args>
+    void logWrite(const LogSite& site, LogSiteId& siteId, std::format_string<Args...> format, Args&&... args)
+    {
+        [&]<size_t... Index>(std::index_sequence<Index...>) {
+            logDispatch(site, siteId, format.get(), &logDecode<LogStored<Args>...>, logPrepare(args, format.get(), Index)...);
+        }(std::index_sequence_for<Args...>{});
+    }
+
+    constexpr char LOG_SUPPRESSED_FORMAT[] = "(message repeated {} times in {:.1f}s)";
+
+    // Wakes the logger thread to report the suppressed calls of a window nobody logs after
+    extern void logSuppressionPending();
+
+    // Per call site state of LOG_THROTTLED. Calls are counted in one second windows,
+    // the call that opens a window learns how many the previous window dropped.
+    // When no call comes, the logger thread reports them once the window closed, or at shutdown.
+    class LogLimiter
+    {
+    public:
+        static constexpr uint64_t WINDOW = 1'000'000'000;
+
+        struct Suppressed
+        {
+            uint32_t count = 0;
+            uint64_t nanos = 0;     // Length of the window they were dropped in
+        };
+
+        // Call sites are function statics, they stay in the list until the program exits
+        LogLimiter(const LogSite& site, LogSiteId& summarySiteId, uint32_t perSecond)
+            : site(site), summarySiteId(summarySiteId), perSecond(perSecond)
+        {
+            next = all.load(std::memory_order_relaxed);
+            while (!all.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed)) {}
+        }
+
+        bool allow(Suppressed& suppressed)
+        {
+            uint64_t now = Clock::nanos();
+            uint64_t start = windowStart.load(std::memory_order_relaxed);
+            if (now - start >= WINDOW && windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+            {
+                uint32_t calls = count.exchange(1, std::memory_order_relaxed);
+                if (calls > perSecond) suppressed = { calls - perSecond, now - start };
+                return true;
+            }
+
+            uint32_t calls = count.fetch_add(1, std::memory_order_relaxed);
+            if (calls == perSecond) logSuppressionPending();
+            return calls < perSecond;
+        }
+
+        // Logger thread. Takes the calls dropped in a window that closed with no call to report
+        // them, force takes the ones of the current window too. waiting is set when a window
+        // with dropped calls is still open.
+        bool takeSuppressed(uint64_t now, bool force, Suppressed& suppressed, bool& waiting)
+        {
+            uint64_t start = windowStart.load(std::memory_order_relaxed);
+            if (count.load(std::memory_order_relaxed) <= perSecond) return false;
+            if (now - start < WINDOW && !force)
+            {
+                waiting = true;
+                return false;
+            }
+
+            // Lost to a call that opened the next window, that call reports them
+            if (!windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) return false;
+
+            uint32_t calls = count.exchange(0, std::memory_order_relaxed);
+            if (calls <= perSecond) return false;
+
+            suppressed = { calls - perSecond, now - start };
+            return true;
+        }
+
+        static LogLimiter* First() { return all.load(std::memory_order_acquire); }
+        LogLimiter* Next() const { return next; }
+
+        const LogSite& site;
+        LogSiteId&     summarySiteId;
+
+    private:
+        inline static std::atomic<LogLimiter*> all = nullptr;
+
+        uint32_t    perSecond;
+        LogLimiter* next = nullptr;
+        std::atomic<uint64_t> windowStart = 0;
+        std::atomic<uint32_t> count = 0;
+    };
+
+    inline void logSuppressed(const LogSite& site, LogSiteId& siteId, const LogLimiter::Suppressed& suppressed)
+    {
+        logWrite(site, siteId, LOG_SUPPRESSED_FORMAT, suppressed.count, suppressed.nanos / 1e9);
+    }
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #define CONSOLE_COLOR_RESET   "\u001b[0m"
 #define CONSOLE_COLOR_RED     "\x1b[31m"
@@ -58,30 +424,112 @@ namespace Core
 #define CONSOLE_COLOR_MAGENTA "\x1b[35m"
 #define CONSOLE_COLOR_CYAN    "\x1b[36m"
 
-#define LOG_LEVEL_INFO  std::format("{}Info{}",  CONSOLE_COLOR_CYAN, CONSOLE_COLOR_RESET)
-#define LOG_LEVEL_WARN  std::format("{}Warn{}",  CONSOLE_COLOR_YELLOW, CONSOLE_COLOR_RESET)
-#define LOG_LEVEL_ERROR std::format("{}Error{}", CONSOLE_COLOR_RED,  CONSOLE_COLOR_RESET)
+// Declares the per call site statics: the compile time description and the flight recorder id
+#define LOG_CALL_SITE(logLevel)                                                                                 \
+    static constexpr ::Core::LogSite logCallSite = ::Core::logSite(logLevel, std::source_location::current()); \
+    static ::Core::LogSiteId logCallSiteId
+
+// A filtered out call costs one comparison, the call site is described at compile time
+#define LOG(logLevel, ...)                                                                                      \
+    do                                                                                                          \
+    {                                                                                                           \
+        if (::Core::logEnabled(logLevel))                                                                       \
+        {                                                                                                       \
+            LOG_CALL_SITE(logLevel);                                                                            \
+            ::Core::logWrite(logCallSite, logCallSiteId, __VA_ARGS__);                                         \
+        }                                                                                                       \
+    } while (0)
+
+// At most perSecond messages a second from this call site, the rest are counted and
+// reported as one line together with the next message that gets through, or by the
+// logger thread shortly after the second is over
+#define LOG_THROTTLED(logLevel, perSecond, ...)                                                                 \
+    do                                                                                                          \
+    {                                                                                                           \
+        if (::Core::logEnabled(logLevel))                                                                       \
+        {                                                                                                       \
+            LOG_CALL_SITE(logLevel);                                                                            \
+            static ::Core::LogSiteId logSummarySiteId;                                                          \
+            static ::Core::LogLimiter logLimiter(logCallSite, logSummarySiteId, perSecond);                     \
+            ::Core::LogLimiter::Suppressed logDropped;                                                         \
+            if (logLimiter.allow(logDropped))                                                                   \
+            {                                                                                                   \
+                if (logDropped.count) ::Core::logSuppressed(logCallSite, logSummarySiteId, logDropped);        \
+                ::Core::logWrite(logCallSite, logCallSiteId, __VA_ARGS__);                                     \
+            }                                                                                                   \
+        }                                                                                                       \
+    } while (0)
 
-#define LOG(logLevel, ...) std::cout << std::format("[{}] {} {}", __LOG_LOCATION__, logLevel, __VA_ARGS__) << std::endl;
-//#define LOG(logLevel, ...)  log(std::format("{} [{}] {}",  logLevel, __LOG_LOCATION__, __VA_ARGS__));
+// Sampling: logs the 1st, (n+1)th, (2n+1)th... call
+#define LOG_EVERY_N(logLevel, n, ...)                                                                           \
+    do                                                                                                          \
+    {                                                                                                           \
+        if (::Core::logEnabled(logLevel))                                                                       \
+        {                                                                                                       \
+            LOG_CALL_SITE(logLevel);                                                                            \
+            static std::atomic<uint32_t> logCalls;                                                              \
+            if (logCalls.fetch_add(1, std::memory_order_relaxed) % (n) == 0)                                    \
+                ::Core::logWrite(logCallSite, logCallSiteId, __VA_ARGS__);                                     \
+        }                                                                                                       \
+    } while (0)
 
-#define LOG_INFO(...)  LOG(LOG_LEVEL_INFO,  __VA_ARGS__)
-#define LOG_WARN(...)  LOG(LOG_LEVEL_WARN,  __VA_ARGS__)
-#define LOG_ERROR(...) LOG(LOG_LEVEL_ERROR, __VA_ARGS__)
+// Only the first n calls, later ones cost a load and a comparison
+#define LOG_FIRST_N(logLevel, n, ...)                                                                           \
+    do                                                                                                          \
+    {                                                                                                           \
+        if (::Core::logEnabled(logLevel))                                                                       \
+        {                                                                                                       \
+            LOG_CALL_SITE(logLevel);                                                                            \
+            static std::atomic<uint32_t> logCalls;                                                              \
+            if (logCalls.load(std::memory_order_relaxed) < (n) && logCalls.fetch_add(1, std::memory_order_relaxed) < (n)) \
+                ::Core::logWrite(logCallSite, logCallSiteId, __VA_ARGS__);                                     \
+        }                                                                                                       \
+    } while (0)
 
-#define log_info(...)  LOG_INFO(std::format(__VA_ARGS__))
-#define log_warn(...)  LOG_WARN(std::format(__VA_ARGS__))
-#define log_error(...) LOG_ERROR(std::format(__VA_ARGS__))
+#define LOG_ONCE(logLevel, ...) LOG_FIRST_N(logLevel, 1, __VA_ARGS__)
 
-#define log_size(...) LOG_INFO(GET_ARG_COUNT(__VA_ARGS__))
+#define LOG_INFO(...)  LOG(::Core::LogLevel::Info,  __VA_ARGS__)
+#define LOG_WARN(...)  LOG(::Core::LogLevel::Warn,  __VA_ARGS__)
+#define LOG_ERROR(...) LOG(::Core::LogLevel::Error, __VA_ARGS__)
+
+#define log_info(...)  LOG_INFO(__VA_ARGS__)
+#define log_warn(...)  LOG_WARN(__VA_ARGS__)
+#define log_error(...) LOG_ERROR(__VA_ARGS__)
+
+#define log_size(...) LOG_INFO("{}", GET_ARG_COUNT(__VA_ARGS__))
 
 #if defined(DEBUG)
-    #define LOG_LEVEL_DEBUG std::format("{}Debug:{}", CONSOLE_COLOR_MAGENTA, CONSOLE_COLOR_RESET)
-    #define LOG_DEBUG(...) LOG(LOG_LEVEL_DEBUG, __VA_ARGS__)
+    #define LOG_DEBUG(...) LOG(::Core::LogLevel::Debug, __VA_ARGS__)
 
-    #define log_debug(...) LOG_DEBUG(std::format(__VA_ARGS__))
+    #define log_debug(...) LOG_DEBUG(__VA_ARGS__)
 #else
     #define LOG_DEBUG(...)
     #define log_debug(...)
 #endif
 }
+
+// Text formatted on the calling thread already, its spec is skipped rather than applied twice
+template <typename T> requires std::is_same_v<T, Core::LogFormatted> || std::is_same_v<T, Core::LogFormattedView>
+struct std::formatter<T>
+{
+    constexpr auto parse(std::format_parse_context& context)
+    {
+        auto it = context.begin();
+        for (int depth = 0; it != context.end() && (*it != '}' || depth > 0); ++it)
+        {
+            if (*it == '{')
+            {
+                ++depth;
+                // A nested field still uses up an automatic argument index
+                if (it + 1 != context.end() && *(it + 1) == '}') context.next_arg_id();
+            }
+            else if (*it == '}') --depth;
+        }
+        return it;
+    }
+
+    auto format(const T& value, std::format_context& context) const
+    {
+        return std::copy(value.text.begin(), value.text.end(), context.out());
+    }
+};
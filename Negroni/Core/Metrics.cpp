@@ -0,0 +1,62 @@
+#include "Metrics.h"
+
+#include <cassert>
+#include <deque>
+#include <unordered_map>
+
+namespace Core
+{
+    // Metrics live until the program exits, references handed out never dangle
+    static std::mutex registryMutex;
+    static std::deque<Scope<Metric>> registry;
+    static std::unordered_map<str, Metric*> registryByName;
+
+    template<typename T>
+    static T& Register(const str& name, MetricKind kind)
+    {
+        std::lock_guard<std::mutex> guard(registryMutex);
+
+        auto it = registryByName.find(name);
+        if (it != registryByName.end())
+        {
+            assert(it->second->Kind() == kind && "Metric registered twice with different kinds");
+            return *(T*)it->second;
+        }
+
+        T* metric = new T(name);
+        registry.emplace_back(metric);
+        registryByName[name] = metric;
+        return *metric;
+    }
+
+    MetricCounter& Metrics::Counter(const str& name)
+    {
+        return Register<MetricCounter>(name, MetricKind::Counter);
+    }
+
+    MetricGauge& Metrics::Gauge(const str& name)
+    {
+        return Register<MetricGauge>(name, MetricKind::Gauge);
+    }
+
+    MetricHistogram& Metrics::Histogram(const str& name)
+    {
+        return Register<MetricHistogram>(name, MetricKind::Histogram);
+    }
+
+    void Metrics::Sample()
+    {
+        std::lock_guard<std::mutex> guard(registryMutex);
+        for (auto& metric : registry) metric->Sample();
+    }
+
+    std::vector<Metric*> Metrics::All()
+    {
+        std::lock_guard<std::mutex> guard(registryMutex);
+
+        std::vector<Metric*> all;
+        all.reserve(registry.size());
+        for (auto& metric : registry) all.push_back(metric.get());
+        return all;
+    }
+}
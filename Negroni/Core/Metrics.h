@@ -0,0 +1,149 @@
+#pragma once
+
+#include "Base.h"
+#include "Histogram.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace Core
+{
+    constexpr u32 METRIC_HISTORY = 256;
+
+    enum class MetricKind : u8 { Counter, Gauge, Histogram };
+
+    // A named value sampled once per frame into a history. Register with Metrics::Counter(),
+    // Metrics::Gauge() or Metrics::Histogram() and update from any thread.
+    class Metric
+    {
+    public:
+        Metric(const str& name, MetricKind kind) : name(name), kind(kind) {}
+        virtual ~Metric() = default;
+
+        const str& Name() const { return name; }
+        MetricKind Kind() const { return kind; }
+
+        // Per frame values of the last METRIC_HISTORY frames, oldest first from HistoryOffset()
+        const float* History() const { return history; }
+        u32 HistoryOffset() const { return frame % METRIC_HISTORY; }
+        float Last() const { return frame ? history[(frame - 1) % METRIC_HISTORY] : 0.0f; }
+
+    protected:
+        friend class Metrics;
+
+        // Called by Metrics::Sample() at the end of every frame
+        virtual void Sample() = 0;
+
+        void Push(float value)
+        {
+            history[frame % METRIC_HISTORY] = value;
+            ++frame;
+        }
+
+    private:
+        str name;
+        MetricKind kind;
+        float history[METRIC_HISTORY] = {};
+        u64 frame = 0;
+    };
+
+    // Events per frame: draw calls, jobs run, bytes uploaded
+    class MetricCounter : public Metric
+    {
+    public:
+        explicit MetricCounter(const str& name) : Metric(name, MetricKind::Counter) {}
+
+        void Add(i64 count = 1) { value.fetch_add(count, std::memory_order_relaxed); }
+
+        // Since the start, up to the last sample
+        i64 Total() const { return total; }
+
+    protected:
+        void Sample() override
+        {
+            i64 count = value.exchange(0, std::memory_order_relaxed);
+            total += count;
+            Push((float)count);
+        }
+
+    private:
+        std::atomic<i64> value = 0;
+        i64 total = 0;
+    };
+
+    // A level that is set rather than counted: objects culled, queue depth, active scripts
+    class MetricGauge : public Metric
+    {
+    public:
+        explicit MetricGauge(const str& name) : Metric(name, MetricKind::Gauge) {}
+
+        void Set(double newValue) { value.store(newValue, std::memory_order_relaxed); }
+        void Add(double delta) { value.fetch_add(delta, std::memory_order_relaxed); }
+        double Value() const { return value.load(std::memory_order_relaxed); }
+
+    protected:
+        void Sample() override
+        {
+            Push((float)Value());
+        }
+
+    private:
+        std::atomic<double> value = 0.0;
+    };
+
+    // Distribution of values recorded during a frame, the history keeps the per frame mean
+    class MetricHistogram : public Metric
+    {
+    public:
+        explicit MetricHistogram(const str& name) : Metric(name, MetricKind::Histogram) {}
+
+        // Locks, so hot loops fill a local Histogram and record it once with the overload below
+        void Record(u64 value)
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            current.Record(value);
+        }
+
+        void Record(const Histogram& values)
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            current.Merge(values);
+        }
+
+        // Everything recorded during the last sampled frame
+        const Histogram& LastFrame() const { return last; }
+
+    protected:
+        void Sample() override
+        {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                last = current;
+                current.Clear();
+            }
+            Push((float)last.Mean());
+        }
+
+    private:
+        std::mutex mutex;
+        Histogram current;
+        Histogram last;
+    };
+
+    class Metrics
+    {
+    public:
+        // The same name gives the same metric. Lookups lock, so keep the reference:
+        //   static MetricCounter& drawCalls = Metrics::Counter("Renderer/Draw calls");
+        static MetricCounter& Counter(const str& name);
+        static MetricGauge& Gauge(const str& name);
+        static MetricHistogram& Histogram(const str& name);
+
+        // Closes the frame of every metric, once per frame on the thread that shows them
+        static void Sample();
+
+        // In registration order
+        static std::vector<Metric*> All();
+    };
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "Atomic.h"
+
+#include <atomic>
+#include <cstddef>
+
+namespace Core
+{
+	// Bounded lock-free multi-producer/multi-consumer queue with the same surface as Queue.
+	// Every slot carries a sequence number that tells whether it is free for the producer
+	// of a given position or ready for its consumer, so producers and consumers only
+	// contend on a single compare-exchange of their own position.
+	// The batch operations claim a whole run of slots with that one compare-exchange.
+	template<typename ValueType, std::size_t Capacity = 1024>
+	class MpmcQueue
+	{
+		static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "MpmcQueue capacity must be a power of two");
+
+	public:
+		MpmcQueue()
+		{
+			for (std::size_t i = 0; i < Capacity; ++i)
+			{
+				cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		MpmcQueue(const MpmcQueue&) = delete;
+		MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+		void send(const ValueType& toSend)
+		{
+			sendBatch(&toSend, 1);
+		}
+
+		bool trySend(const ValueType& toSend)
+		{
+			return trySendBatch(&toSend, 1) == 1;
+		}
+
+		void receive(ValueType& toReceive)
+		{
+			receiveBatch(&toReceive, 1);
+		}
+
+		bool tryReceive(ValueType& toReceive)
+		{
+			return tryReceiveBatch(&toReceive, 1) == 1;
+		}
+
+		// Sends all items, waiting for free slots when the queue is full.
+		void sendBatch(const ValueType* items, std::size_t count)
+		{
+			Backoff backoff;
+			while (count > 0)
+			{
+				std::size_t sent = trySendBatch(items, count);
+				if (sent == 0)
+				{
+					backoff.pause();
+					continue;
+				}
+				items += sent;
+				count -= sent;
+				backoff.reset();
+			}
+		}
+
+		// Sends as many items as there are free slots for. Returns the number sent.
+		std::size_t trySendBatch(const ValueType* items, std::size_t count)
+		{
+			std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+			while (true)
+			{
+				std::size_t claimed = 0;
+				while (claimed < count)
+				{
+					const std::size_t sequence = cells[(position + claimed) & MASK].sequence.load(std::memory_order_acquire);
+					if (sequence != position + claimed) break;
+					++claimed;
+				}
+
+				if (claimed == 0)
+				{
+					const std::size_t sequence = cells[position & MASK].sequence.load(std::memory_order_acquire);
+					if ((std::ptrdiff_t)(sequence - position) < 0) return 0; // Full
+					position = enqueuePosition.load(std::memory_order_relaxed);
+					continue;
+				}
+
+				if (enqueuePosition.compare_exchange_weak(position, position + claimed, std::memory_order_relaxed))
+				{
+					for (std::size_t i = 0; i < claimed; ++i)
+					{
+						Cell& cell = cells[(position + i) & MASK];
+						cell.value = items[i];
+						cell.sequence.store(position + i + 1, std::memory_order_release);
+					}
+					return claimed;
+				}
+			}
+		}
+
+		// Waits until at least one item is available, then takes up to maxCount of them.
+		std::size_t receiveBatch(ValueType* items, std::size_t maxCount)
+		{
+			Backoff backoff;
+			while (true)
+			{
+				std::size_t received = tryReceiveBatch(items, maxCount);
+				if (received > 0) return received;
+				backoff.pause();
+			}
+		}
+
+		// Takes up to maxCount ready items. Returns the number received.
+		std::size_t tryReceiveBatch(ValueType* items, std::size_t maxCount)
+		{
+			std::size_t position = dequeuePosition.load(std::memory_order_relaxed);
+			while (true)
+			{
+				std::size_t claimed = 0;
+				while (claimed < maxCount)
+				{
+					const std::size_t sequence = cells[(position + claimed) & MASK].sequence.load(std::memory_order_acquire);
+					if (sequence != position + claimed + 1) break;
+					++claimed;
+				}
+
+				if (claimed == 0)
+				{
+					const std::size_t sequence = cells[position & MASK].sequence.load(std::memory_order_acquire);
+					if ((std::ptrdiff_t)(sequence - (position + 1)) < 0) return 0; // Empty
+					position = dequeuePosition.load(std::memory_order_relaxed);
+					continue;
+				}
+
+				if (dequeuePosition.compare_exchange_weak(position, position + claimed, std::memory_order_relaxed))
+				{
+					for (std::size_t i = 0; i < claimed; ++i)
+					{
+						Cell& cell = cells[(position + i) & MASK];
+						items[i] = std::move(cell.value);
+						cell.sequence.store(position + i + Capacity, std::memory_order_release);
+					}
+					return claimed;
+				}
+			}
+		}
+
+		// Approximate when called concurrently with send/receive.
+		size_t size() const
+		{
+			const std::size_t enqueued = enqueuePosition.load(std::memory_order_acquire);
+			const std::size_t dequeued = dequeuePosition.load(std::memory_order_acquire);
+			return enqueued > dequeued ? enqueued - dequeued : 0;
+		}
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		static constexpr size_t capacity() { return Capacity; }
+
+	private:
+		static constexpr std::size_t MASK = Capacity - 1;
+
+		struct Cell
+		{
+			std::atomic<std::size_t> sequence;
+			ValueType value;
+		};
+
+		alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> enqueuePosition = 0;
+		alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> dequeuePosition = 0;
+		alignas(CACHE_LINE_SIZE) Cell cells[Capacity];
+	};
+}
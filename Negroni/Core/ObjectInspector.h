@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Base.h"
+#include "SpscQueue.h"
+#include "SwapChain.h"
+
+#include <cstring>
+
+namespace Core
+{
+    // What an editor may see of one object, copied out by the game loop at the end of a frame
+    struct ObjectSnapshot
+    {
+        ID        id = ID::None;
+        Transform transform;
+        bool      useTintColor = false;
+        RGB       tintColor = { 1.0f, 1.0f, 1.0f };
+        str       meshName;
+        str       scriptName;
+    };
+
+    // A change made by an editor, applied by the game loop at the start of the next frame
+    struct ObjectEdit
+    {
+        u32  id;                // Plain, a default constructed ID would draw a new random one
+        bool useTintColor;
+        RGB  tintColor;
+    };
+
+    // Lets an editor on another thread (the render thread when pipelined) show and change one
+    // object without touching it. The game thread publishes snapshots and applies the edits,
+    // the editor only reads snapshots and sends edits.
+    class ObjectInspector
+    {
+    public:
+        // Before the game thread starts, or from the game thread
+        void SetObject(const ObjectRef& newObject) { object = newObject; }
+
+        // Game thread, at the start of a frame
+        void ApplyEdits()
+        {
+            ObjectEdit edit;
+            while (edits.tryReceive(edit))
+            {
+                // Edits sent for an object shown before the last SetObject() are dropped
+                if (!object || edit.id != (u32)object->id) continue;
+
+                object->useTintColor = edit.useTintColor;
+                memcpy(object->tintColor, edit.tintColor, sizeof(RGB));
+            }
+        }
+
+        // Game thread, at the end of a frame. The back slot is overwritten in place,
+        // the strings keep their capacity.
+        void Publish()
+        {
+            ObjectSnapshot& snapshot = snapshots.back();
+            if (object)
+            {
+                snapshot.id = object->id;
+                snapshot.transform = object->transform;
+                snapshot.useTintColor = object->useTintColor;
+                memcpy(snapshot.tintColor, object->tintColor, sizeof(RGB));
+                snapshot.meshName = object->mesh ? object->mesh->name : "<NULL>";
+                snapshot.scriptName = object->script->Name();
+            }
+            else
+            {
+                snapshot.id = ID::None;
+            }
+            snapshots.publish();
+        }
+
+        // Editor thread. id is ID::None until the game thread published an object.
+        const ObjectSnapshot& Read() { return snapshots.read(); }
+
+        // Editor thread. Fails when the game thread is far behind, the edit is then lost.
+        bool Edit(const ObjectEdit& edit) { return edits.trySend(edit); }
+
+    private:
+        ObjectRef object;
+        SwapChain<ObjectSnapshot> snapshots;
+        SpscQueue<ObjectEdit, 64> edits;
+    };
+}
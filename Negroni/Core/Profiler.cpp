@@ -0,0 +1,465 @@
+#include "Profiler.h"
+#include "Histogram.h"
+#include "Thread.h"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+
+namespace Core
+{
+    // Collector side state of one thread
+    struct LaneBuilder
+    {
+        std::vector<ProfileLane::Entry> entries;
+        std::vector<u32> open;      // Indices of the entries still waiting for their End
+        u64 frameStart = 0;
+    };
+
+    static std::atomic<ProfilerBuffer*> buffers[PROFILER_MAX_THREADS];
+    static std::atomic<u32> bufferCount = 0;
+
+    static std::mutex profilerMutex;
+    static str threadNames[PROFILER_MAX_THREADS];
+    static LaneBuilder builders[PROFILER_MAX_THREADS];
+    static std::vector<ProfileLane> lanes;
+
+    // A ring of histograms per call site, the oldest slice is cleared and reused
+    struct ScopeWindow
+    {
+        Histogram slices[PROFILER_STAT_SLICES];
+    };
+
+    static std::unordered_map<const ProfileSite*, ScopeWindow> scopeWindows;
+    static std::vector<ProfileScopeStats> scopeStats;
+    static u32 statSlice = 0;
+    static u32 statSliceFrames = 0;
+
+    struct CapturedEvent
+    {
+        ProfileEvent event;
+        u32 thread;
+    };
+
+    static std::vector<CapturedEvent> captured;
+    static u32 captureFrames = 0;
+    static u32 captureFramesLeft = 0;
+    static str capturePath;
+
+    // Spike detector: a ring of per Collect() event lists, reused to avoid allocating every frame
+    static ProfileSpikeSettings spikeSettings;
+    static std::vector<std::vector<CapturedEvent>> spikeRing;
+    static u64 spikeFrame = 0;
+    static u64 spikeLastTicks = 0;
+    static float spikeDurations[PROFILER_SPIKE_MEDIAN_FRAMES];
+    static u32 spikeDurationCount = 0;
+    static u32 spikeFramesLeft = 0;    // Frames still to record after a spike before dumping
+    static u32 spikeDumps = 0;
+
+    ProfilerBuffer* Profiler::Register()
+    {
+        // Hands the buffer back when the thread exits, its later blocks are not recorded
+        static thread_local struct ThreadExit
+        {
+            ~ThreadExit()
+            {
+                if (threadBuffer) threadBuffer->state.store(ProfilerBufferState::Released, std::memory_order_release);
+                threadBuffer = nullptr;
+            }
+        } threadExit;
+
+        // The buffers of exited threads first, head and tail carry on where they were
+        u32 used = std::min(bufferCount.load(std::memory_order_acquire), PROFILER_MAX_THREADS);
+        for (u32 i = 0; i < used; ++i)
+        {
+            ProfilerBuffer* buffer = buffers[i].load(std::memory_order_acquire);
+            ProfilerBufferState free = ProfilerBufferState::Free;
+            if (buffer && buffer->state.compare_exchange_strong(free, ProfilerBufferState::Owned, std::memory_order_acquire))
+            {
+                buffer->depth = 0;
+                return buffer;
+            }
+        }
+
+        u32 index = bufferCount.fetch_add(1, std::memory_order_relaxed);
+        if (index >= PROFILER_MAX_THREADS) return nullptr;
+
+        ProfilerBuffer* buffer = new ProfilerBuffer(index);
+        buffers[index].store(buffer, std::memory_order_release);
+        return buffer;
+    }
+
+    void Profiler::SetThreadName(const char* name)
+    {
+        ProfilerBuffer* buffer = ThreadBuffer();
+        if (!buffer) return;
+
+        std::lock_guard<std::mutex> guard(profilerMutex);
+        threadNames[buffer->id] = name;
+    }
+
+    static void Publish(LaneBuilder& builder, ProfileLane& lane, u64 start, u64 end)
+    {
+        lane.entries.swap(builder.entries);
+        builder.entries.clear();
+        lane.start = start;
+        lane.end = end;
+    }
+
+    static void WriteJsonString(str& out, const char* text)
+    {
+        out += '"';
+        for (const char* c = text; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\') out += '\\';
+            if ((unsigned char)*c < 0x20) std::format_to(std::back_inserter(out), "\\u{:04x}", (int)*c);
+            else out += *c;
+        }
+        out += '"';
+    }
+
+    // Everything a trace file is written from, handed over to the trace writer thread
+    struct TraceDump
+    {
+        std::vector<CapturedEvent> events;
+        std::vector<str> threadNames;
+        u32 frames;
+        str path;
+    };
+
+    // Chrome trace event format: B/E pairs per thread, an instant event per frame mark
+    static void WriteTrace(const TraceDump& dump)
+    {
+        const auto& [events, names, frames, path] = dump;
+
+        str out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        u32 count = (u32)names.size();
+        for (u32 i = 0; i < count; ++i)
+        {
+            std::format_to(std::back_inserter(out), "{{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":", i);
+            WriteJsonString(out, names[i].empty() ? std::format("Thread {}", i).c_str() : names[i].c_str());
+            out += "}},\n";
+        }
+
+        u64 origin = events.empty() ? 0 : events.front().event.ticks;
+        for (auto& [event, thread] : events) origin = std::min(origin, event.ticks);
+
+        // Blocks that began before the capture have no Begin, the ones still open get an End
+        std::vector<u32> depth(count);
+        u64 last = origin;
+        for (auto& [event, thread] : events)
+        {
+            double ts = Clock::ticksToNanos(event.ticks - origin) / 1000.0;
+            last = std::max(last, event.ticks);
+
+            switch (event.type)
+            {
+            case ProfileEventType::Begin:
+                depth[thread]++;
+                std::format_to(std::back_inserter(out), "{{\"ph\":\"B\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"name\":", thread, ts);
+                WriteJsonString(out, event.site->name);
+                out += "},\n";
+                break;
+
+            case ProfileEventType::End:
+                if (depth[thread] == 0) break;
+                depth[thread]--;
+                std::format_to(std::back_inserter(out), "{{\"ph\":\"E\",\"pid\":1,\"tid\":{},\"ts\":{:.3f}}},\n", thread, ts);
+                break;
+
+            case ProfileEventType::Frame:
+                std::format_to(std::back_inserter(out), "{{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"name\":\"Frame\"}},\n", thread, ts);
+                break;
+            }
+        }
+
+        for (u32 thread = 0; thread < count; ++thread)
+        {
+            for (; depth[thread] > 0; --depth[thread])
+                std::format_to(std::back_inserter(out), "{{\"ph\":\"E\",\"pid\":1,\"tid\":{},\"ts\":{:.3f}}},\n", thread, Clock::ticksToNanos(last - origin) / 1000.0);
+        }
+
+        // No trailing comma after the last event
+        if (out.ends_with(",\n")) out.resize(out.size() - 2);
+        out += "\n]}\n";
+
+        std::ofstream file(path, std::ios::binary);
+        file.write(out.data(), out.size());
+        if (file)
+            log_info("{} frames, {} events written to {}", frames, events.size(), path);
+        else
+            log_error("Can't write the profiler capture to {}", path);
+    }
+
+    // Builds the JSON and writes the file off the thread that calls Collect().
+    // Profiler::Shutdown() writes the dumps still queued and ends the thread.
+    class TraceWriter : public Thread<TraceDump*>
+    {
+    public:
+        TraceWriter() : Thread(IdleStrategy::Blocking()) {}
+        ~TraceWriter() { stop(); }
+
+        void execute(TraceDump*& dump) override
+        {
+            WriteTrace(*dump);
+            delete dump;
+        }
+    };
+
+    // Started by the first dump, guarded by profilerMutex
+    static Scope<TraceWriter> traceWriter;
+
+    // Called with profilerMutex held, which also keeps send() to one thread at a time
+    static void QueueTrace(std::vector<CapturedEvent>&& events, u32 frames, const str& path)
+    {
+        if (!traceWriter) traceWriter = MakeScope<TraceWriter>();
+
+        u32 count = std::min(bufferCount.load(std::memory_order_acquire), PROFILER_MAX_THREADS);
+        TraceDump* dump = new TraceDump{ std::move(events), std::vector<str>(threadNames, threadNames + count), frames, path };
+        traceWriter->send(dump);
+    }
+
+    static void WriteSpike()
+    {
+        // Oldest first, skipping the slots never filled when the spike came early
+        u64 size = spikeRing.size();
+        u64 first = spikeFrame >= size ? spikeFrame - size : 0;
+        std::vector<CapturedEvent> events;
+        for (u64 frame = first; frame < spikeFrame; ++frame)
+        {
+            auto& slot = spikeRing[frame % size];
+            events.insert(events.end(), slot.begin(), slot.end());
+        }
+
+        QueueTrace(std::move(events), (u32)(spikeFrame - first), std::format("{}.{}.json", spikeSettings.path, ++spikeDumps));
+    }
+
+    // Called after the events of a frame went into the ring, `now` closes that frame
+    static void DetectSpike(u64 now)
+    {
+        u64 last = spikeLastTicks;
+        spikeLastTicks = now;
+        ++spikeFrame;
+
+        if (spikeFramesLeft > 0)
+        {
+            if (--spikeFramesLeft == 0) WriteSpike();
+            return;
+        }
+
+        if (last == 0 || spikeDumps >= spikeSettings.maxDumps) return;
+        float frameMs = Clock::ticksToNanos(now - last) / 1e6f;
+
+        float medianMs = 0.0f;
+        u32 samples = std::min(spikeDurationCount, PROFILER_SPIKE_MEDIAN_FRAMES);
+        if (spikeSettings.medianMultiple > 0.0f && samples >= PROFILER_SPIKE_MEDIAN_FRAMES / 2)
+        {
+            float sorted[PROFILER_SPIKE_MEDIAN_FRAMES];
+            std::copy(spikeDurations, spikeDurations + samples, sorted);
+            std::nth_element(sorted, sorted + samples / 2, sorted + samples);
+            medianMs = sorted[samples / 2];
+        }
+
+        bool overBudget = spikeSettings.budgetMs > 0.0f && frameMs > spikeSettings.budgetMs;
+        bool overMedian = medianMs > 0.0f && frameMs > medianMs * spikeSettings.medianMultiple;
+        if (overBudget || overMedian)
+        {
+            log_warn("Frame spike: {:.1f} ms (median {:.1f} ms), dumping {} frames around it", frameMs, medianMs, spikeRing.size());
+            spikeFramesLeft = spikeSettings.framesAfter;
+            if (spikeFramesLeft == 0) WriteSpike();
+            return;
+        }
+
+        // Spikes stay out of the median
+        spikeDurations[spikeDurationCount++ % PROFILER_SPIKE_MEDIAN_FRAMES] = frameMs;
+    }
+
+    static void UpdateScopeStats()
+    {
+        scopeStats.clear();
+
+        u32 next = (statSlice + 1) % PROFILER_STAT_SLICES;
+        for (auto it = scopeWindows.begin(); it != scopeWindows.end();)
+        {
+            Histogram merged;
+            for (auto& slice : it->second.slices) merged.Merge(slice);
+            it->second.slices[next].Clear();
+
+            if (merged.Count() == 0)
+            {
+                it = scopeWindows.erase(it);
+                continue;
+            }
+
+            scopeStats.push_back({
+                .site  = it->first,
+                .count = merged.Count(),
+                .min   = merged.Min(),
+                .max   = merged.Max(),
+                .mean  = merged.Mean(),
+                .p50   = merged.Percentile(50.0),
+                .p95   = merged.Percentile(95.0),
+                .p99   = merged.Percentile(99.0),
+            });
+            ++it;
+        }
+
+        std::sort(scopeStats.begin(), scopeStats.end(), [](const ProfileScopeStats& a, const ProfileScopeStats& b) { return a.p99 > b.p99; });
+        statSlice = next;
+    }
+
+    bool Profiler::StartCapture(u32 frames, const str& path)
+    {
+        std::lock_guard<std::mutex> guard(profilerMutex);
+        if (captureFramesLeft > 0 || frames == 0) return false;
+
+        captured.clear();
+        captureFrames = captureFramesLeft = frames;
+        capturePath = path;
+        log_info("capturing {} frames", frames);
+        return true;
+    }
+
+    void Profiler::DetectSpikes(const ProfileSpikeSettings& settings)
+    {
+        std::lock_guard<std::mutex> guard(profilerMutex);
+
+        spikeSettings = settings;
+        spikeRing.clear();
+        if (settings.budgetMs > 0.0f || settings.medianMultiple > 0.0f)
+            spikeRing.resize(settings.framesBefore + 1 + settings.framesAfter);
+
+        spikeFrame = 0;
+        spikeLastTicks = 0;
+        spikeDurationCount = 0;
+        spikeFramesLeft = 0;
+    }
+
+    bool Profiler::Capturing()
+    {
+        std::lock_guard<std::mutex> guard(profilerMutex);
+        return captureFramesLeft > 0;
+    }
+
+    void Profiler::Shutdown()
+    {
+        Scope<TraceWriter> writer;
+        {
+            std::lock_guard<std::mutex> guard(profilerMutex);
+            writer = std::move(traceWriter);
+        }
+        // Joined without the lock, so a Collect() on another thread is not held up meanwhile
+        writer.reset();
+    }
+
+    void Profiler::Collect()
+    {
+        std::lock_guard<std::mutex> guard(profilerMutex);
+
+        std::vector<CapturedEvent>* spikeEvents = nullptr;
+        if (!spikeRing.empty())
+        {
+            spikeEvents = &spikeRing[spikeFrame % spikeRing.size()];
+            spikeEvents->clear();
+        }
+
+        u32 count = std::min(bufferCount.load(std::memory_order_acquire), PROFILER_MAX_THREADS);
+        for (u32 i = 0; i < count; ++i)
+        {
+            ProfilerBuffer* buffer = buffers[i].load(std::memory_order_acquire);
+            if (!buffer) continue;
+
+            if (i >= lanes.size())
+            {
+                lanes.resize(i + 1);
+                lanes[i].thread = i;
+            }
+
+            // Released after the last event of its thread, so this drain merges everything
+            bool released = buffer->state.load(std::memory_order_acquire) == ProfilerBufferState::Released;
+
+            ProfileLane& lane = lanes[i];
+            LaneBuilder& builder = builders[i];
+            lane.name = threadNames[i].empty() ? std::format("Thread {}", i) : threadNames[i];
+            lane.dropped = buffer->dropped.load(std::memory_order_relaxed);
+
+            buffer->Drain([&](const ProfileEvent& event) {
+                if (captureFramesLeft > 0) captured.push_back({ event, i });
+                if (spikeEvents) spikeEvents->push_back({ event, i });
+
+                u64 time = (u64)Clock::ticksToNanos(event.ticks);
+
+                switch (event.type)
+                {
+                case ProfileEventType::Begin:
+                    builder.open.push_back((u32)builder.entries.size());
+                    builder.entries.push_back({ event.site, (u32)builder.open.size() - 1, time, 0 });
+                    break;
+
+                case ProfileEventType::End:
+                {
+                    if (builder.open.empty()) break;
+                    auto& entry = builder.entries[builder.open.back()];
+                    entry.elapsed = time - entry.start;
+                    scopeWindows[entry.site].slices[statSlice].Record(entry.elapsed);
+                    builder.open.pop_back();
+                    break;
+                }
+
+                case ProfileEventType::Frame:
+                    // A frame marked from inside a block keeps growing until the block ends
+                    if (builder.open.empty())
+                    {
+                        Publish(builder, lane, builder.frameStart ? builder.frameStart : time, time);
+                    }
+                    builder.frameStart = time;
+                    break;
+                }
+            });
+
+            if (!buffer->marksFrames.load(std::memory_order_relaxed) && builder.open.empty() && !builder.entries.empty())
+            {
+                u64 end = builder.entries.front().start;
+                for (auto& entry : builder.entries) end = std::max(end, entry.start + entry.elapsed);
+                Publish(builder, lane, builder.entries.front().start, end);
+            }
+
+            if (released)
+            {
+                // The lane keeps the last frame of the thread until the next owner publishes one
+                threadNames[i].clear();
+                builder = {};
+                buffer->marksFrames.store(false, std::memory_order_relaxed);
+                buffer->dropped.store(0, std::memory_order_relaxed);
+                buffer->state.store(ProfilerBufferState::Free, std::memory_order_release);
+            }
+        }
+
+        if (++statSliceFrames == PROFILER_STAT_SLICE_FRAMES)
+        {
+            statSliceFrames = 0;
+            UpdateScopeStats();
+        }
+
+        if (captureFramesLeft > 0 && --captureFramesLeft == 0)
+        {
+            QueueTrace(std::move(captured), captureFrames, capturePath);
+            captured = {};
+        }
+
+        if (spikeEvents) DetectSpike(Clock::ticks());
+    }
+
+    const std::vector<ProfileLane>& Profiler::Lanes()
+    {
+        return lanes;
+    }
+
+    const std::vector<ProfileScopeStats>& Profiler::ScopeStats()
+    {
+        return scopeStats;
+    }
+}
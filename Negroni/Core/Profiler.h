@@ -1,72 +1,278 @@
 #pragma once
 
+#include "Atomic.h"
 #include "Base.h"
+#include "Clock.h"
 
-#include <cassert>
+#include <atomic>
 #include <chrono>
+#include <source_location>
 #include <string>
+#include <vector>
 
 using namespace std::chrono;
 
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
 #ifdef PROFILER_ENABLED
-    #define ProfileBlock(name) Profiler _(name);
-    #define ProfileClear() Profiler::size = 0;
+    // The name must be a string literal. The call site is described once at compile time,
+    // at run time a block costs two TSC reads and two events in the thread's buffer.
+    #define ProfileBlock(name)                                                                                                   \
+        static constexpr ::Core::ProfileSite PROFILE_CONCAT(profileSite, __LINE__) = ::Core::profileSite(name, std::source_location::current()); \
+        ::Core::Profiler PROFILE_CONCAT(profileBlock, __LINE__)(&PROFILE_CONCAT(profileSite, __LINE__));
+    // Ends the calling thread's frame, its lane then shows the blocks since the previous one
+    #define ProfileFrame() Profiler::Frame();
+    #define ProfileThread(name) Profiler::SetThreadName(name);
 #else
     #define ProfileBlock(name)
-    #define ProfileClear()
+    #define ProfileFrame()
+    #define ProfileThread(name)
 #endif
 
 namespace Core
 {
-    constexpr u32 PROFILER_MAX_ENTRIES = 1024;
+    constexpr u32 PROFILER_MAX_THREADS = 64;
+    constexpr u32 PROFILER_BUFFER_SIZE = 16 * 1024;    // Events per thread, a power of two
 
-    class Profiler
+    // Scope statistics cover the last PROFILER_STAT_SLICES x PROFILER_STAT_SLICE_FRAMES Collect() calls
+    constexpr u32 PROFILER_STAT_SLICES = 10;
+    constexpr u32 PROFILER_STAT_SLICE_FRAMES = 60;
+
+    // Rolling median window of the spike detector, in Collect() calls
+    constexpr u32 PROFILER_SPIKE_MEDIAN_FRAMES = 120;
+
+    // How the last frame of a pipelined thread split between work and waiting for its peer
+    struct ThreadFrameStats
+    {
+        std::atomic<float> busyMs = 0.0f;
+        std::atomic<float> waitMs = 0.0f;
+        std::atomic<u64>   frames = 0;
+    };
+
+    // Everything known about a ProfileBlock at compile time, one static instance per call site
+    struct ProfileSite
+    {
+        const char* name;
+        const char* file;
+        u32         line;
+    };
+
+    constexpr ProfileSite profileSite(const char* name, const std::source_location& where)
+    {
+        return { name, where.file_name(), where.line() };
+    }
+
+    enum class ProfileEventType : u8 { Begin, End, Frame };
+
+    struct ProfileEvent
+    {
+        const ProfileSite* site;        // nullptr for End and Frame
+        u64                ticks;       // Clock::ticks(), converted when collected
+        ProfileEventType   type;
+    };
+
+    enum class ProfilerBufferState : u8
+    {
+        Owned,      // Written by a live thread
+        Released,   // Its thread exited, Collect() still has to merge what is left
+        Free,       // Merged, the next thread that registers takes it over
+    };
+
+    // Events of one thread. Only that thread writes, only Profiler::Collect() reads.
+    // The buffer and its lane outlive the thread and go to the next thread that registers.
+    class ProfilerBuffer
     {
     public:
+        explicit ProfilerBuffer(u32 id) : id(id) {}
+
+        // Fails instead of overwriting, keeping `reserve` events free behind the new one
+        bool Push(ProfileEventType type, const ProfileSite* site, u32 reserve = 0)
+        {
+            u64 head = this->head.load(std::memory_order_relaxed);
+            if (head + 1 + reserve - cachedTail > PROFILER_BUFFER_SIZE)
+            {
+                cachedTail = tail.load(std::memory_order_acquire);
+                if (head + 1 + reserve - cachedTail > PROFILER_BUFFER_SIZE)
+                {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+
+            events[head & (PROFILER_BUFFER_SIZE - 1)] = { site, Clock::ticks(), type };
+            this->head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        template<typename Func>
+        void Drain(Func func)
+        {
+            u64 tail = this->tail.load(std::memory_order_relaxed);
+            u64 head = this->head.load(std::memory_order_acquire);
+            for (; tail < head; ++tail)
+            {
+                func(events[tail & (PROFILER_BUFFER_SIZE - 1)]);
+            }
+            this->tail.store(tail, std::memory_order_release);
+        }
+
+        const u32 id;
+        // Producer side: blocks whose Begin made it into the buffer and are still open
+        u32 depth = 0;
+        std::atomic<bool> marksFrames = false;
+        std::atomic<u64> dropped = 0;
+        std::atomic<ProfilerBufferState> state = ProfilerBufferState::Owned;
+
+    private:
+        alignas(CACHE_LINE_SIZE) std::atomic<u64> head = 0;
+        u64 cachedTail = 0;
+
+        alignas(CACHE_LINE_SIZE) std::atomic<u64> tail = 0;
+
+        ProfileEvent events[PROFILER_BUFFER_SIZE];
+    };
+
+    // The last complete frame of one thread
+    struct ProfileLane
+    {
         struct Entry
         {
-            str name;
+            const ProfileSite* site;
             u32 indent = 0;
-            i64 elapsed = 0;
+            u64 start = 0;      // Clock::ticksToNanos(Clock::ticks()), not on the Clock::nanos() timeline
+            u64 elapsed = 0;    // Nanoseconds
         };
 
-        inline static Entry entries[PROFILER_MAX_ENTRIES];
-        inline static i32 size = 0;
+        u32 thread = 0;
+        str name;
+        std::vector<Entry> entries;    // In call order, children follow their parent
+        u64 start = 0;
+        u64 end = 0;
+        u64 dropped = 0;               // Events lost to a full buffer so far
 
-        Profiler(const std::string& name)
+        // Milliseconds spent in the outermost blocks
+        float TotalMs() const
         {
-            assert(Profiler::size < PROFILER_MAX_ENTRIES);
-            this->index = Profiler::size;
+            u64 total = 0;
+            for (auto& entry : entries)
+                if (entry.indent == 0) total += entry.elapsed;
+            return total / 1e6f;
+        }
+    };
 
-            auto& entry = Profiler::entries[this->index];
-            entry.name = name;
-            entry.indent = Profiler::indent;
+    // Durations of one call site over the statistics window, all threads together, in nanoseconds
+    struct ProfileScopeStats
+    {
+        const ProfileSite* site;
+        u64 count = 0;
+        u64 min = 0;
+        u64 max = 0;
+        double mean = 0.0;
+        u64 p50 = 0;
+        u64 p95 = 0;
+        u64 p99 = 0;
+    };
 
-            Profiler::size = (Profiler::size + 1) % PROFILER_MAX_ENTRIES;
-            Profiler::indent += 1;
+    // A frame is a spike when it is over budget or far above the rolling median. The frames
+    // around it are written as a Chrome trace to <path>.<n>.json.
+    struct ProfileSpikeSettings
+    {
+        float budgetMs = 0.0f;          // 0 ignores the budget
+        float medianMultiple = 0.0f;    // 0 ignores the median
+        u32   framesBefore = 60;
+        u32   framesAfter = 30;
+        u32   maxDumps = 10;            // Per run, hitches tend to come in bursts
+        str   path = "Negroni.spike";
+    };
 
-            this->start = high_resolution_clock::now();
+    class Profiler
+    {
+    public:
+        explicit Profiler(const ProfileSite* site)
+        {
+            buffer = ThreadBuffer();
+#ifdef ALLOCATION_TRACKING
+            // After ThreadBuffer(), registering a thread is not charged to the block
+            parent = currentSite;
+            currentSite = site;
+#endif
+            // Keep room for the End of every open block, a recorded Begin always gets its End
+            if (buffer && buffer->Push(ProfileEventType::Begin, site, buffer->depth + 1))
+                buffer->depth++;
+            else
+                buffer = nullptr;
         }
 
         ~Profiler()
         {
-            auto end = high_resolution_clock::now();
-
-            Profiler::indent -= 1;
+#ifdef ALLOCATION_TRACKING
+            currentSite = parent;
+#endif
+            if (!buffer) return;
 
-            auto& entry = Profiler::entries[this->index];
-            entry.elapsed = duration_cast<microseconds>(end - start).count();
+            buffer->depth--;
+            buffer->Push(ProfileEventType::End, nullptr);
         }
 
-        static void Clear()
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+
+        static void Frame()
         {
-            Profiler::size = 0;
+            ProfilerBuffer* buffer = ThreadBuffer();
+            if (!buffer) return;
+
+            buffer->marksFrames.store(true, std::memory_order_relaxed);
+            buffer->Push(ProfileEventType::Frame, nullptr, buffer->depth);
         }
 
+        static void SetThreadName(const char* name);
+
+#ifdef ALLOCATION_TRACKING
+        // Innermost open ProfileBlock of the calling thread, nullptr outside of any
+        static const ProfileSite* CurrentSite() { return currentSite; }
+#endif
+
+        // Merges the events of all threads into lanes. Call once per frame from the thread
+        // that shows them. Threads that never call Frame() get the blocks since the last Collect().
+        static void Collect();
+        static const std::vector<ProfileLane>& Lanes();
+        // Refreshed every PROFILER_STAT_SLICE_FRAMES Collect() calls, slowest p99 first
+        static const std::vector<ProfileScopeStats>& ScopeStats();
+
+        // Records every event of the next `frames` Collect() calls and writes them to `path`
+        // as Chrome trace event JSON, for chrome://tracing or ui.perfetto.dev
+        static bool StartCapture(u32 frames, const str& path);
+        static bool Capturing();
+
+        // Keeps the events of the last framesBefore + 1 + framesAfter Collect() calls and dumps
+        // them when a spike is framesAfter frames old. Both thresholds at 0 turn it off.
+        static void DetectSpikes(const ProfileSpikeSettings& settings);
+
+        // Waits for the trace files still being written, call before the program exits
+        static void Shutdown();
+
     private:
-        u32 index;
-        steady_clock::time_point start;
+        static ProfilerBuffer* ThreadBuffer()
+        {
+            if (!threadRegistered)
+            {
+                threadRegistered = true;
+                threadBuffer = Register();
+            }
+            return threadBuffer;
+        }
+
+        static ProfilerBuffer* Register();
+
+        ProfilerBuffer* buffer;
+#ifdef ALLOCATION_TRACKING
+        const ProfileSite* parent;
+        inline static thread_local const ProfileSite* currentSite = nullptr;
+#endif
 
-        inline static u32 indent = 0;
+        inline static thread_local ProfilerBuffer* threadBuffer = nullptr;
+        inline static thread_local bool threadRegistered = false;
     };
 }
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Base.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+namespace Core
+{
+    struct Mat4f { float m[4][4]; };
+
+    // Everything the renderer needs to draw one object, copied out of the game state
+    // at the end of the frame. Plain data only, so the render thread never touches
+    // the objects the scripts keep mutating.
+    struct RenderProxy
+    {
+        Mat4f  world;           // Transposed, ready to be uploaded to the shaders
+        void*  meshData;        // Renderer specific mesh buffers, nullptr = nothing to draw
+        u32    indexCount;
+        float  tintColor[4];    // Alpha is 1 when the tint color is used
+        Sphere bounds;          // World space
+        bool   selected;
+    };
+
+    typedef std::vector<RenderProxy> RenderList;
+
+    // M = Scaling * RotationRollPitchYaw * Translation, transposed
+    inline Mat4f WorldMatrix(const Transform& transform)
+    {
+        constexpr float k = std::numbers::pi_v<float> / 180.0f;
+
+        float pitch = transform.rotation.pitch * k;
+        float yaw   = transform.rotation.yaw * k;
+        float roll  = transform.rotation.roll * k;
+
+        float SP = sinf(-pitch), SY = sinf(yaw), SR = sinf(roll);
+        float CP = cosf(-pitch), CY = cosf(yaw), CR = cosf(roll);
+
+        float r0x = (CP * CY) * transform.scale.x;
+        float r0y = (CP * SY) * transform.scale.x;
+        float r0z = (SP) * transform.scale.x;
+
+        float r1x = (SR * SP * CY - CR * SY) * transform.scale.y;
+        float r1y = (SR * SP * SY + CR * CY) * transform.scale.y;
+        float r1z = (-SR * CP) * transform.scale.y;
+
+        float r2x = (-(CR * SP * CY + SR * SY)) * transform.scale.z;
+        float r2y = (CY * SR - CR * SP * SY) * transform.scale.z;
+        float r2z = (CR * CP) * transform.scale.z;
+
+        return { {
+            { r0x, r1x, r2x, transform.location.x },
+            { r0y, r1y, r2y, transform.location.y },
+            { r0z, r1z, r2z, transform.location.z },
+            { 0.f, 0.f, 0.f, 1.f },
+        } };
+    }
+
+    inline float Lerp(float from, float to, float alpha)
+    {
+        return from + (to - from) * alpha;
+    }
+
+    // Rotations take the short way around, so 350 -> 10 degrees turns by 20 degrees
+    inline Transform Lerp(const Transform& from, const Transform& to, float alpha)
+    {
+        auto lerpAngle = [alpha](float from, float to) {
+            float delta = std::fmod(to - from + 540.0f, 360.0f) - 180.0f;
+            return from + delta * alpha;
+        };
+
+        Transform result;
+        result.location = { Lerp(from.location.x, to.location.x, alpha), Lerp(from.location.y, to.location.y, alpha), Lerp(from.location.z, to.location.z, alpha) };
+        result.rotation = { lerpAngle(from.rotation.pitch, to.rotation.pitch), lerpAngle(from.rotation.yaw, to.rotation.yaw), lerpAngle(from.rotation.roll, to.rotation.roll) };
+        result.scale    = { Lerp(from.scale.x, to.scale.x, alpha), Lerp(from.scale.y, to.scale.y, alpha), Lerp(from.scale.z, to.scale.z, alpha) };
+        return result;
+    }
+
+    // alpha is how far the frame is between the last two fixed steps, see Object::interpolate
+    inline RenderProxy MakeRenderProxy(const Object& object, float alpha = 1.0f)
+    {
+        RenderProxy proxy = {};
+
+        const Mesh* mesh = object.mesh.get();
+        if (mesh == nullptr || mesh->data == nullptr) return proxy;
+
+        const Transform transform = object.interpolate ? Lerp(object.previousTransform, object.transform, alpha) : object.transform;
+        const Vec3f& location = transform.location;
+        const Vec3f& scale = transform.scale;
+        float scaleFactor = std::max(scale.x, std::max(scale.y, scale.z));
+
+        proxy.world = WorldMatrix(transform);
+        proxy.meshData = mesh->data;
+        proxy.indexCount = (u32)mesh->indices.size();
+        proxy.tintColor[0] = object.tintColor[0];
+        proxy.tintColor[1] = object.tintColor[1];
+        proxy.tintColor[2] = object.tintColor[2];
+        proxy.tintColor[3] = object.useTintColor ? 1.0f : 0.0f;
+        proxy.bounds.center = {
+            mesh->boundingSphere.center.x + location.x,
+            mesh->boundingSphere.center.y + location.y,
+            mesh->boundingSphere.center.z + location.z,
+        };
+        proxy.bounds.radius = mesh->boundingSphere.radius * scaleFactor;
+        proxy.selected = object.selected;
+
+        return proxy;
+    }
+}
@@ -2,20 +2,35 @@
 
 #include "Renderer.h"
 #include "Logger.h"
+#include "Metrics.h"
+#include "AllocationTracker.h"
+#include "Telemetry.h"
 #include "Gui.h"
 #include "GameLoop.h"
+#include "SwapChain.h"
 
+#include <algorithm>
+#include <atomic>
 #include <mutex>
+#include <semaphore>
 #include <thread>
 
 namespace Core
 {
+    constexpr u32 MAX_FRAME_LATENCY = 3;
+
+    // Draws the frames produced by the game thread on its own thread, so the
+    // simulation of frame N+1 overlaps the rendering and presenting of frame N.
+    // Draw() blocks once `frameLatency` frames have been handed over but not presented yet,
+    // which bounds how far the simulation can run ahead of the screen.
     class RenderThread
     {
     public:
-        RenderThread(Renderer& renderer, Gui& gui) : renderer(renderer), gui(gui)
+        RenderThread(Renderer& renderer, Gui& gui, u32 frameLatency = 2)
+            : renderer(renderer), gui(gui),
+              framesInFlight(std::clamp(frameLatency, 1u, MAX_FRAME_LATENCY)),
+              framesQueued(0)
         {
-            memset(&gameState, 0, sizeof(GameState));
             thread = std::thread(Start, this);
         }
 
@@ -24,17 +39,47 @@ namespace Core
             Stop();
         }
 
-        void Draw(const GameState& gameState)
+        // Called by the game thread with the finished frame, which is extracted
+        // straight into the back slot of the swap chain
+        void Draw(const GameLoop& game)
         {
-            std::lock_guard<std::mutex> guard(key);
-            this->gameState = gameState;
+            if (quit) return;
+            framesInFlight.acquire();
+            if (quit) return;
+
+            game.ExtractRenderList(frames.back());
+            frames.publish();
+            framesQueued.release();
         }
 
-        void Stop()
+        // Called by the window thread, applied by the render thread before its next frame
+        void Resize(size_t width, size_t height)
         {
-            std::lock_guard<std::mutex> guard(key);
+            pendingSize.store(((u64)width << 32) | (u64)height, std::memory_order_release);
+        }
+
+        // ImGui is not thread safe, the window thread has to hold this
+        // while it feeds window messages to ImGui
+        std::mutex& GuiMutex() { return guiMutex; }
+
+        const ThreadFrameStats& Stats() const { return stats; }
+
+        // Makes Draw() return and the thread end after its current frame, without waiting for it
+        void RequestStop()
+        {
+            if (quit.exchange(true)) return;
+
+            // Wake up both sides of the handoff
+            framesQueued.release();
+            framesInFlight.release(MAX_FRAME_LATENCY);
+        }
+
+        // Set when the thread is done, Stop() then joins without blocking
+        bool Exited() const { return exited.load(std::memory_order_acquire); }
 
-            quit = true;
+        void Stop()
+        {
+            RequestStop();
 
             if (thread.joinable())
             {
@@ -47,35 +92,72 @@ namespace Core
         static void Start(RenderThread* self)
         {
             log_info("started");
+            ProfileThread("Render thread");
 
-            const float color[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+            constexpr float HEX_0C = 12.0f / 255.0f;
+            const float color[4] = { HEX_0C, HEX_0C, HEX_0C, 1.0f };
 
             while (true)
             {
+                auto waitStart = high_resolution_clock::now();
+                self->framesQueued.acquire();
+
+                // Frames that arrived meanwhile are superseded by the latest one
+                u32 skipped = 0;
+                while (self->framesQueued.try_acquire()) ++skipped;
+
                 if (self->quit)
                 {
                     log_info("quit");
                     break;
                 }
 
-                self->renderer.Clear((rgba)color);
+                auto frameStart = high_resolution_clock::now();
+
+                u64 size = self->pendingSize.exchange(0, std::memory_order_acquire);
+                if (size) self->renderer.Resize(size >> 32, size & 0xFFFFFFFF);
+
                 {
-                    std::lock_guard<std::mutex> guard(self->key);
-                    self->renderer.Draw(self->gameState);
+                    ProfileBlock("[RenderThread] Frame");
+                    self->renderer.Clear((rgba)color);
+                    self->renderer.Draw(self->frames.read());
+                    {
+                        std::lock_guard<std::mutex> guard(self->guiMutex);
+                        self->gui.Draw();
+                    }
+                    self->renderer.Present();
                 }
-                self->gui.Draw();
-                self->renderer.Present();
+                ProfileFrame();
+                Profiler::Collect();
+                AllocationTracker::Frame();
+                JobSystem::Frame();
+                Metrics::Sample();
+                Telemetry::Publish();
+
+                auto frameEnd = high_resolution_clock::now();
+                self->stats.busyMs = duration<float, std::milli>(frameEnd - frameStart).count();
+                self->stats.waitMs = duration<float, std::milli>(frameStart - waitStart).count();
+                self->stats.frames++;
+
+                self->framesInFlight.release(1 + skipped);
             }
-        }
 
-        std::thread thread;
-        std::mutex key;
+            self->exited.store(true, std::memory_order_release);
+        }
 
         Renderer& renderer;
         Gui& gui;
 
-        GameState gameState;
+        SwapChain<RenderList> frames;
+        std::counting_semaphore<MAX_FRAME_LATENCY * 2> framesInFlight;
+        std::counting_semaphore<MAX_FRAME_LATENCY * 2> framesQueued;
+        std::atomic<u64> pendingSize = 0;
+        std::mutex guiMutex;
 
-        bool quit = false;
+        std::atomic<bool> quit = false;
+        std::atomic<bool> exited = false;
+        ThreadFrameStats stats;
+
+        std::thread thread;
     };
 }
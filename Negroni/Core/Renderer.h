@@ -1,6 +1,6 @@
 #pragma once
 
-#include "../Game.h"
+#include "RenderList.h"
 
 namespace Core
 {
@@ -11,7 +11,7 @@ namespace Core
 		virtual void LoadMesh(const MeshRef& mesh) = 0;
 		virtual void UnloadMesh(const MeshRef & mesh) = 0;
 		virtual void Clear(const rgba color) = 0;
-		virtual void Draw(const GameState&) = 0;
+		virtual void Draw(const RenderList&) = 0;
 		virtual void Present() = 0;
 		virtual void SetVSync(bool enabled) = 0;
 		virtual void SetFXAA(bool enabled) = 0;
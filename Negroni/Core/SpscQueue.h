@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Atomic.h"
+
+#include <atomic>
+#include <cstddef>
+
+namespace Core
+{
+	// Bounded lock-free ring buffer with the same surface as Queue.
+	// Exactly one thread may send and exactly one thread may receive.
+	// Both sides keep a cached copy of the other side's index, so a message
+	// costs one release store and no lock or notify in the common case.
+	template<typename ValueType, std::size_t Capacity = 1024>
+	class SpscQueue
+	{
+		static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+	public:
+		SpscQueue() = default;
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		void send(const ValueType& toSend)
+		{
+			Backoff backoff;
+			while (!trySend(toSend))
+			{
+				backoff.pause();
+			}
+		}
+
+		bool trySend(const ValueType& toSend)
+		{
+			const std::size_t writeIndex = tail.load(std::memory_order_relaxed);
+			if (writeIndex - cachedHead == Capacity)
+			{
+				cachedHead = head.load(std::memory_order_acquire);
+				if (writeIndex - cachedHead == Capacity) return false;
+			}
+
+			slots[writeIndex & MASK] = toSend;
+			tail.store(writeIndex + 1, std::memory_order_release);
+			return true;
+		}
+
+		void receive(ValueType& toReceive)
+		{
+			Backoff backoff;
+			while (!tryReceive(toReceive))
+			{
+				backoff.pause();
+			}
+		}
+
+		bool tryReceive(ValueType& toReceive)
+		{
+			const std::size_t readIndex = head.load(std::memory_order_relaxed);
+			if (readIndex == cachedTail)
+			{
+				cachedTail = tail.load(std::memory_order_acquire);
+				if (readIndex == cachedTail) return false;
+			}
+
+			toReceive = std::move(slots[readIndex & MASK]);
+			head.store(readIndex + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Approximate when called concurrently with send/receive.
+		size_t size() const
+		{
+			return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+		}
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		static constexpr size_t capacity() { return Capacity; }
+
+	private:
+		static constexpr std::size_t MASK = Capacity - 1;
+
+		// Consumer line
+		alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head = 0;
+		std::size_t cachedTail = 0;
+
+		// Producer line
+		alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail = 0;
+		std::size_t cachedHead = 0;
+
+		alignas(CACHE_LINE_SIZE) ValueType slots[Capacity];
+	};
+}
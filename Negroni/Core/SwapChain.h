@@ -1,33 +1,65 @@
 #pragma once
 
+#include "Atomic.h"
 #include "Base.h"
 
-#include <utility>
+#include <atomic>
 
 namespace Core
 {
+	// Lock-free triple buffer for one writer and one reader thread.
+	// The writer fills the back slot in place and publishes it with a single atomic
+	// exchange; the reader picks up the latest published slot by reference.
+	// Neither side ever blocks or copies, and the reader simply sees the same
+	// snapshot again when nothing new was published.
 	template<typename ValueType>
 	class SwapChain
 	{
 	public:
+		// Writer side. The slot holds whatever was written into it two publishes ago,
+		// so it has to be fully overwritten before publish().
+		ValueType& back()
+		{
+			return buffers[backIndex];
+		}
+
+		void publish()
+		{
+			u8 previous = middle.exchange(backIndex | DIRTY, std::memory_order_acq_rel);
+			backIndex = previous & INDEX_MASK;
+		}
+
 		void write(const ValueType& value)
 		{
-			std::lock_guard<std::mutex> guard(key);
-			buffers[backIndex] = value;
-			std::swap(frontIndex, backIndex);
+			back() = value;
+			publish();
 		}
 
-		ValueType read()
+		// Reader side. The reference stays valid until the next read().
+		const ValueType& read()
 		{
-			std::lock_guard<std::mutex> guard(key);
+			if (middle.load(std::memory_order_relaxed) & DIRTY)
+			{
+				u8 previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+				frontIndex = previous & INDEX_MASK;
+			}
 			return buffers[frontIndex];
 		}
 
+		// True when a snapshot newer than the last read() has been published
+		bool ready() const
+		{
+			return middle.load(std::memory_order_acquire) & DIRTY;
+		}
+
 	private:
-		std::mutex key;
+		static constexpr u8 INDEX_MASK = 0x3;
+		static constexpr u8 DIRTY = 0x4;
+
+		ValueType buffers[3];
 
-		ValueType buffers[2];
-		i8 frontIndex = 0;
-		i8 backIndex = 1;
+		alignas(CACHE_LINE_SIZE) std::atomic<u8> middle = 1;
+		alignas(CACHE_LINE_SIZE) u8 frontIndex = 0;
+		alignas(CACHE_LINE_SIZE) u8 backIndex = 2;
 	};
 }
@@ -0,0 +1,151 @@
+#include "Telemetry.h"
+#include "Clock.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <new>
+#include <string>
+#include <string_view>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Core
+{
+    static TelemetrySegment* segment = nullptr;
+    // Built here first, so the seqlock is only held for one copy
+    static TelemetrySnapshot staging;
+    static u64 lastNanos = 0;
+
+    static void copyName(char (&to)[TELEMETRY_NAME_SIZE], std::string_view text)
+    {
+        size_t size = std::min<size_t>(text.size(), TELEMETRY_NAME_SIZE - 1);
+        memcpy(to, text.data(), size);
+        to[size] = '\0';
+    }
+
+    // Like the flight recorder, the mapping stays until the process is gone
+    static void* mapShared(const char* name, size_t size)
+    {
+#if defined(_WIN32)
+        HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, (DWORD)size, name);
+        if (!mapping) return nullptr;
+
+        // The handle is kept open, a named mapping disappears with its last handle
+        return MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+#else
+        std::string path = std::string("/") + name;
+        int file = shm_open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (file < 0) return nullptr;
+
+        if (ftruncate(file, (off_t)size) != 0)
+        {
+            close(file);
+            return nullptr;
+        }
+
+        void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        close(file);
+        return view == MAP_FAILED ? nullptr : view;
+#endif
+    }
+
+    bool Telemetry::Open(const char* name)
+    {
+        if (segment) return true;
+
+        void* view = mapShared(name, sizeof(TelemetrySegment));
+        if (!view) return false;
+
+        // A segment left by an earlier run is reset, monitors see the sequence start over
+        memset(view, 0, sizeof(TelemetrySegment));
+        segment = new (view) TelemetrySegment();
+        segment->size = sizeof(TelemetrySegment);
+#if defined(_WIN32)
+        segment->processId = (uint32_t)GetCurrentProcessId();
+#else
+        segment->processId = (uint32_t)getpid();
+#endif
+        memcpy(segment->magic, TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC));
+
+        log_info("publishing telemetry to {}", name);
+        return true;
+    }
+
+    bool Telemetry::Enabled()
+    {
+        return segment != nullptr;
+    }
+
+    void Telemetry::Publish()
+    {
+        if (!segment) return;
+
+        u64 now = Clock::nanos();
+        staging.frame++;
+        staging.nanos = now;
+        staging.frameMs = lastNanos ? (now - lastNanos) / 1e6f : 0.0f;
+        lastNanos = now;
+
+        const auto& lanes = Profiler::Lanes();
+        staging.threadCount = 0;
+        for (auto& lane : lanes)
+        {
+            if (staging.threadCount == TELEMETRY_MAX_THREADS) break;
+            TelemetryThread& thread = staging.threads[staging.threadCount++];
+            copyName(thread.name, lane.name);
+            thread.frameMs = lane.TotalMs();
+            thread.dropped = lane.dropped;
+        }
+
+        const auto& scopeStats = Profiler::ScopeStats();
+        staging.scopeCount = 0;
+        for (auto& stats : scopeStats)
+        {
+            if (staging.scopeCount == TELEMETRY_MAX_SCOPES) break;
+            TelemetryScope& scope = staging.scopes[staging.scopeCount++];
+            copyName(scope.name, stats.site->name);
+            scope.count = stats.count;
+            scope.mean = stats.mean;
+            scope.min = stats.min;
+            scope.p50 = stats.p50;
+            scope.p95 = stats.p95;
+            scope.p99 = stats.p99;
+            scope.max = stats.max;
+        }
+
+        static std::vector<Metric*> metrics;
+        static u64 metricsFrame = 0;
+        // Metrics are registered lazily, refresh the list now and then rather than locking every frame
+        if (staging.frame - metricsFrame >= 60 || metrics.empty())
+        {
+            metrics = Metrics::All();
+            metricsFrame = staging.frame;
+        }
+
+        staging.metricCount = 0;
+        for (Metric* metric : metrics)
+        {
+            if (staging.metricCount == TELEMETRY_MAX_METRICS) break;
+            TelemetryMetric& entry = staging.metrics[staging.metricCount++];
+            copyName(entry.name, metric->Name());
+            entry.kind = (uint32_t)metric->Kind();
+            entry.value = metric->Last();
+            entry.total = metric->Kind() == MetricKind::Counter ? ((MetricCounter*)metric)->Total() : 0;
+        }
+
+        // Seqlock: odd while writing, readers retry when it changed under them
+        u64 sequence = segment->sequence.load(std::memory_order_relaxed);
+        segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&segment->snapshot, &staging, sizeof(staging));
+        segment->sequence.store(sequence + 2, std::memory_order_release);
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Live engine statistics in a named shared memory segment, for monitoring tools running
+// in another process (TelemetryMonitor). The engine publishes a snapshot once per frame
+// under a seqlock: readers copy it without ever blocking or slowing down the game.
+//
+// Segment layout: TelemetrySegment, a header followed by one TelemetrySnapshot.
+
+namespace Core
+{
+    constexpr char     TELEMETRY_MAGIC[8]     = "NGRTLM1";
+    constexpr char     TELEMETRY_NAME[]       = "Negroni.telemetry";
+    constexpr uint32_t TELEMETRY_NAME_SIZE    = 64;
+    constexpr uint32_t TELEMETRY_MAX_THREADS  = 64;
+    constexpr uint32_t TELEMETRY_MAX_SCOPES   = 64;
+    constexpr uint32_t TELEMETRY_MAX_METRICS  = 128;
+
+    // The last complete frame of a profiled thread
+    struct TelemetryThread
+    {
+        char     name[TELEMETRY_NAME_SIZE];
+        float    frameMs;
+        uint32_t reserved;
+        uint64_t dropped;       // Profiler events lost so far
+    };
+
+    // Profiler scope statistics, in nanoseconds
+    struct TelemetryScope
+    {
+        char     name[TELEMETRY_NAME_SIZE];
+        uint64_t count;
+        double   mean;
+        uint64_t min;
+        uint64_t p50;
+        uint64_t p95;
+        uint64_t p99;
+        uint64_t max;
+    };
+
+    struct TelemetryMetric
+    {
+        char     name[TELEMETRY_NAME_SIZE];
+        uint32_t kind;          // MetricKind: 0 counter, 1 gauge, 2 histogram
+        float    value;         // Last frame: events, level or mean
+        int64_t  total;         // Counters only, since the start
+    };
+
+    // Plain data, copied as a whole by readers
+    struct TelemetrySnapshot
+    {
+        uint64_t frame;         // Publish() calls so far
+        uint64_t nanos;         // Clock::nanos() when published
+        float    frameMs;       // Time since the previous Publish()
+        uint32_t threadCount;
+        uint32_t scopeCount;
+        uint32_t metricCount;
+        TelemetryThread threads[TELEMETRY_MAX_THREADS];
+        TelemetryScope  scopes[TELEMETRY_MAX_SCOPES];     // Slowest p99 first
+        TelemetryMetric metrics[TELEMETRY_MAX_METRICS];
+    };
+
+    struct TelemetrySegment
+    {
+        char                  magic[8];
+        uint32_t              size;         // sizeof(TelemetrySegment), tells layouts apart
+        uint32_t              processId;
+        std::atomic<uint64_t> sequence;     // Odd while the snapshot is being written, 0 before the first
+        uint64_t              reserved[5];
+        TelemetrySnapshot     snapshot;
+    };
+
+    static_assert(offsetof(TelemetrySegment, snapshot) == 64);
+
+    // Reader side of the seqlock. False when nothing was published yet or the writer
+    // kept the snapshot busy for every attempt.
+    inline bool ReadTelemetry(const TelemetrySegment& segment, TelemetrySnapshot& out, uint32_t attempts = 100)
+    {
+        for (uint32_t i = 0; i < attempts; ++i)
+        {
+            uint64_t before = segment.sequence.load(std::memory_order_acquire);
+            if (before == 0) return false;
+            if (before & 1) continue;
+
+            memcpy(&out, &segment.snapshot, sizeof(out));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (segment.sequence.load(std::memory_order_relaxed) == before) return true;
+        }
+        return false;
+    }
+
+    class Telemetry
+    {
+    public:
+        // Creates or takes over the named segment, Windows named mapping or POSIX shm
+        static bool Open(const char* name = TELEMETRY_NAME);
+        static bool Enabled();
+
+        // Copies the profiler lanes, scope statistics and metrics into the segment.
+        // Call once per frame right after Metrics::Sample(), on the thread that calls Profiler::Collect().
+        static void Publish();
+    };
+}
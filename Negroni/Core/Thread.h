@@ -1,11 +1,19 @@
 #pragma once
 
-#include "Queue.h"
+#include "IdleStrategy.h"
+#include "SpscQueue.h"
 
 #include <thread>
 
 namespace Core
 {
+    // Messages are passed through a lock-free single-producer/single-consumer queue,
+    // so send() must only be called from the thread that owns this object.
+    // While the queue is empty the thread idles according to its IdleStrategy
+    // instead of busy-polling, and by default ends up parked until the next send().
+    // Every Thread costs an OS thread; use Actor for subsystems that only need a mailbox.
+    // Derived classes whose execute() uses their own members must call stop() in their
+    // destructor, ~Thread() runs after the derived part is gone.
     template<typename MessageType>
     class Thread
     {
@@ -17,36 +25,56 @@ namespace Core
         };
 
     public:
-        Thread()
+        explicit Thread(IdleStrategy idleStrategy = IdleStrategy::Adaptive()) : idleStrategy(idleStrategy)
         {
-            thread = std::thread(start, std::ref(messages));
+            thread = std::thread(&Thread::start, this, std::ref(messages));
         }
 
         ~Thread()
         {
+            stop();
+        }
+
+        // Executes the messages sent so far, then ends the thread. Owner thread only.
+        void stop()
+        {
+            if (!thread.joinable()) return;
+
             messages.send({ true });
-            if (thread.joinable())
-            {
-                thread.join();
-            }
+            parker.unpark();
+            thread.join();
         }
 
         void send(MessageType& message)
         {
             messages.send({ false, message });
+            parker.unpark();
+        }
+
+        WakeLatency wakeLatency() const
+        {
+            return parker.wakeLatency();
         }
 
         virtual void execute(MessageType& message) = 0;
 
     private:
-        void start(Queue<QueueItem>& in)
+        void start(SpscQueue<QueueItem>& in)
         {
+            Idler idler(idleStrategy, parker);
+
             while (true)
             {
                 QueueItem qItem;
                 bool received = in.tryReceive(std::ref(qItem));
 
-                if (!received) continue;
+                if (!received)
+                {
+                    idler.idle([&in] { return !in.empty(); });
+                    continue;
+                }
+
+                idler.reset();
 
                 if (qItem.quit)
                     break;
@@ -55,7 +83,9 @@ namespace Core
             }
         }
 
+        IdleStrategy idleStrategy;
+        Parker parker;
+        SpscQueue<QueueItem> messages;
         std::thread thread;
-        Queue<QueueItem> messages;
     };
 }
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Base.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Core
+{
+    // A clock that runs at its own rate. Domains form a tree: every frame the root is
+    // advanced by real time and passes its own, scaled delta time to its children,
+    // so pausing or slowing down a domain does the same to everything bound to it.
+    // Each domain has its own timers, fired as its time passes.
+    // Not thread-safe: domains are advanced and used on the game loop thread.
+    class TimeDomain
+    {
+    public:
+        explicit TimeDomain(str name, TimeDomain* parent = nullptr) : name(std::move(name)), parent(parent)
+        {
+            if (parent) parent->children.push_back(this);
+        }
+
+        ~TimeDomain()
+        {
+            if (parent) std::erase(parent->children, this);
+            for (TimeDomain* child : children) child->parent = nullptr;
+        }
+
+        TimeDomain(const TimeDomain&) = delete;
+        TimeDomain& operator=(const TimeDomain&) = delete;
+
+        // dt is in the parent's time, or in real seconds for a root domain
+        void Advance(float parentDt)
+        {
+            dt = paused ? 0.0f : parentDt * scale;
+            seconds += dt;
+            timers.tick(Millis());
+
+            for (TimeDomain* child : children) child->Advance(dt);
+        }
+
+        void SetScale(float newScale) { scale = std::max(newScale, 0.0f); }
+        float Scale() const { return scale; }
+
+        void Pause() { paused = true; }
+        void Resume() { paused = false; }
+        bool Paused() const { return paused; }
+
+        // Seconds this domain advanced during the current frame
+        float DeltaTime() const { return dt; }
+        // Seconds elapsed in this domain since it was created
+        double Seconds() const { return seconds; }
+        Clock::millisec Millis() const { return (Clock::millisec)(seconds * 1000.0); }
+
+        TimerWheel& Timers() { return timers; }
+        const str& Name() const { return name; }
+
+    private:
+        str         name;
+        TimeDomain* parent;
+        std::vector<TimeDomain*> children;
+
+        float  scale = 1.0f;
+        bool   paused = false;
+        float  dt = 0.0f;
+        double seconds = 0.0;
+
+        TimerWheel timers;
+    };
+
+    // The two domains every game has. GameLoop advances Real() with the frame time.
+    // Subsystems that need their own clock create a TimeDomain under one of them:
+    //
+    //  TimeDomain physicsTime("Physics", &Time::Game());
+    class Time
+    {
+    public:
+        // Wall clock time, keeps running when the game is paused
+        static TimeDomain& Real()
+        {
+            static TimeDomain real("Real");
+            return real;
+        }
+
+        // Scaled and pausable, the default for scripts, timers and coroutines
+        static TimeDomain& Game()
+        {
+            static TimeDomain game("Game", &Real());
+            return game;
+        }
+    };
+}
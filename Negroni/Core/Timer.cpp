@@ -1,86 +1,239 @@
 #include "Timer.h"
+#include "Time.h"
+
+#include <algorithm>
 
 namespace Core
 {
-    class Timer::Task
+    TimerWheel::Handle TimerWheel::set(Action callback, millisec delay, uint32_t times, millisec now)
     {
-    public:
-        uint64_t priority;
-        Action callback;
-        millisec delay;
-        millisec expiration;
-        uint32_t times;
-
-        bool waiting(millisec now) const
-        {
-            return expiration > now;
-        }
+        if (times < 1) return {};
 
-        void execute() const
-        {
-            callback();
-        }
+        // Nothing is waiting, so the wheel can start over from the caller's time
+        if (activeCount == 0 && now > next) next = now;
 
-        bool after(Task_ptr otherTask) const
+        uint32_t index;
+        if (freeTasks.empty())
         {
-            return laterThan(otherTask) || higherPriorityThan(otherTask);
+            index = (uint32_t)tasks.size();
+            tasks.emplace_back();
         }
-
-        bool higherPriorityThan(Task_ptr otherTask) const
+        else
         {
-            return expiration == otherTask->expiration && priority > otherTask->priority;
+            index = freeTasks.back();
+            freeTasks.pop_back();
         }
 
-        bool laterThan(Task_ptr otherTask) const
-        {
-            return expiration > otherTask->expiration;
-        }
+        Task& task = tasks[index];
+        task.priority = count++;
+        task.callback = std::move(callback);
+        task.delay = delay;
+        task.expiration = now + delay;
+        task.times = times;
+
+        insert(index);
+        ++activeCount;
+
+        return { index, task.generation };
+    }
+
+    bool TimerWheel::cancel(Handle handle)
+    {
+        if (!active(handle)) return false;
+        if (tasks[handle.index].level != NONE) unlink(handle.index);
+        release(handle.index);
+        return true;
+    }
 
-        bool reschedule(millisec now)
+    bool TimerWheel::active(Handle handle) const
+    {
+        return handle.index < tasks.size() && tasks[handle.index].generation == handle.generation;
+    }
+
+    void TimerWheel::tick(millisec now)
+    {
+        while (next <= now)
         {
-            --times;
-            if (times <= 0) return false;
-            expiration = now + delay;
-            return true;
+            if (activeCount == 0)
+            {
+                next = now + 1;
+                return;
+            }
+
+            uint32_t index = next & SLOT_MASK;
+            if (index == 0)
+            {
+                // Level 0 wrapped around, pull the next slot of every level that wrapped too
+                for (uint32_t level = 1; level < LEVELS; ++level)
+                {
+                    uint32_t levelIndex = (next >> (level * SLOT_BITS)) & SLOT_MASK;
+                    cascade(level, levelIndex);
+                    if (levelIndex != 0) break;
+                }
+            }
+            else if (levelSize[0] == 0)
+            {
+                // Nothing can expire before level 0 wraps around
+                next = std::min(now + 1, (next | SLOT_MASK) + 1);
+                continue;
+            }
+
+            Slot& slot = slots[0][index];
+            for (uint32_t i = slot.head; i != NONE; i = tasks[i].next)
+            {
+                tasks[i].level = NONE;
+                expired.push_back({ i, tasks[i].generation });
+            }
+            levelSize[0] -= (uint32_t)expired.size();
+            slot = {};
+
+            // Timers set by the callbacks below must not land in the slot being expired
+            ++next;
+            expire(now);
         }
-    };
+    }
 
-    bool Timer::set(Action callback, millisec delay, uint32_t times, millisec now)
+    bool TimerWheel::empty() const
     {
-        if (times < 1) return false;
-        auto task = std::make_shared<Task>(count, callback, delay, now + delay, times);
-        add(task);
-        ++count;
-        return true;
+        return activeCount == 0;
     }
 
-    void Timer::tick(millisec now)
+    size_t TimerWheel::size() const
     {
-        for (auto task : schedule)
+        return activeCount;
+    }
+
+    void TimerWheel::insert(uint32_t index)
+    {
+        Task& task = tasks[index];
+
+        // Overdue tasks fire on the next processed millisecond
+        millisec expiration = std::max(task.expiration, next);
+        millisec distance = expiration - next;
+
+        uint32_t level = 0;
+        while (level < LEVELS - 1 && distance >= (1ull << ((level + 1) * SLOT_BITS))) ++level;
+
+        // Farther than the wheel reaches, park it in the last slot and let cascading bring it back
+        if (distance >= (1ull << (LEVELS * SLOT_BITS))) expiration = next + (1ull << (LEVELS * SLOT_BITS)) - 1;
+
+        task.level = level;
+        task.slot = (expiration >> (level * SLOT_BITS)) & SLOT_MASK;
+        task.next = NONE;
+
+        Slot& slot = slots[level][task.slot];
+        task.prev = slot.tail;
+        if (slot.tail != NONE) tasks[slot.tail].next = index;
+        else slot.head = index;
+        slot.tail = index;
+
+        ++levelSize[level];
+    }
+
+    void TimerWheel::unlink(uint32_t index)
+    {
+        Task& task = tasks[index];
+        Slot& slot = slots[task.level][task.slot];
+
+        if (task.prev != NONE) tasks[task.prev].next = task.next;
+        else slot.head = task.next;
+        if (task.next != NONE) tasks[task.next].prev = task.prev;
+        else slot.tail = task.prev;
+
+        --levelSize[task.level];
+        task.level = NONE;
+        task.prev = task.next = NONE;
+    }
+
+    void TimerWheel::release(uint32_t index)
+    {
+        Task& task = tasks[index];
+        ++task.generation;
+        --activeCount;
+
+        // The running callback is released by expire() once it returns
+        if (index == running) return;
+
+        task.callback = nullptr;
+        freeTasks.push_back(index);
+    }
+
+    void TimerWheel::cascade(uint32_t level, uint32_t index)
+    {
+        Slot slot = slots[level][index];
+        slots[level][index] = {};
+
+        for (uint32_t i = slot.head; i != NONE;)
         {
-            if (task->waiting(now)) break;
-            task->execute();
-            schedule.pop_front();
-            if (task->reschedule(now)) add(task);
+            uint32_t following = tasks[i].next;
+            --levelSize[level];
+            insert(i);
+            i = following;
         }
     }
 
-    void Timer::add(Task_ptr newTask)
+    void TimerWheel::expire(millisec now)
     {
-        for (auto taskIt = schedule.begin(); taskIt != schedule.end(); ++taskIt)
+        // Tasks sharing an expiration run in the order they were set
+        if (expired.size() > 1)
+        {
+            std::sort(expired.begin(), expired.end(), [this](const Expired& a, const Expired& b) {
+                const Task& taskA = tasks[a.index];
+                const Task& taskB = tasks[b.index];
+                return taskA.expiration != taskB.expiration ? taskA.expiration < taskB.expiration : taskA.priority < taskB.priority;
+            });
+        }
+
+        for (size_t i = 0; i < expired.size(); ++i)
         {
-            auto& task = *taskIt;
-            if (task->after(newTask))
+            auto [index, generation] = expired[i];
+
+            // Cancelled by an earlier callback of this batch
+            if (tasks[index].generation != generation) continue;
+
+            running = index;
+            tasks[index].callback();
+            running = NONE;
+
+            Task& task = tasks[index];
+            if (task.generation != generation)
             {
-                schedule.insert(taskIt, newTask);
-                return;
+                // Cancelled itself
+                task.callback = nullptr;
+                freeTasks.push_back(index);
+            }
+            else if (--task.times > 0)
+            {
+                task.expiration = now + task.delay;
+                insert(index);
+            }
+            else
+            {
+                release(index);
             }
         }
-        schedule.push_back(newTask);
+
+        expired.clear();
+    }
+
+    static TimeDomain& DomainOrGame(TimeDomain* domain)
+    {
+        return domain ? *domain : Time::Game();
+    }
+
+    Timer::Handle Timer::set(Action callback, millisec delay, uint32_t times, TimeDomain* domain)
+    {
+        TimeDomain& time = DomainOrGame(domain);
+        return time.Timers().set(std::move(callback), delay, times, time.Millis());
+    }
+
+    bool Timer::cancel(Handle handle, TimeDomain* domain)
+    {
+        return DomainOrGame(domain).Timers().cancel(handle);
     }
 
-    bool Timer::empty()
+    bool Timer::empty(TimeDomain* domain)
     {
-        return schedule.size() == 0;
+        return DomainOrGame(domain).Timers().empty();
     }
 }
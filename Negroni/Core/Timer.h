@@ -4,26 +4,103 @@
 
 #include <functional>
 #include <deque>
+#include <vector>
 
 namespace Core
 {
-    class Timer
+    // Hierarchical timing wheel with millisecond resolution.
+    // Level 0 holds the next 256 ms one slot per millisecond, every next level covers
+    // 256 times more with coarser slots, which are cascaded down as time reaches them.
+    // Insert and cancel are O(1), a tick only touches the slots that expire.
+    class TimerWheel
     {
     public:
         typedef std::function<void()> Action;
         typedef Clock::millisec millisec;
 
-        static bool set(Action callback, millisec delay, uint32_t times = 1, millisec now = Clock::now());
-        static void tick(millisec now = Clock::now());
-        static bool empty();
+        struct Handle
+        {
+            uint32_t index = UINT32_MAX;
+            uint32_t generation = 0;
+
+            explicit operator bool() const { return index != UINT32_MAX; }
+        };
+
+        // Calls the callback after delay, `times` times in a row. Returns an empty handle when times is 0.
+        Handle set(Action callback, millisec delay, uint32_t times, millisec now);
+        // Returns false when the timer has already finished or was cancelled
+        bool cancel(Handle handle);
+        bool active(Handle handle) const;
+        void tick(millisec now);
+        bool empty() const;
+        size_t size() const;
 
     private:
-        typedef class Task;
-        typedef std::shared_ptr<Task> Task_ptr;
+        static constexpr uint32_t LEVELS = 4;
+        static constexpr uint32_t SLOT_BITS = 8;
+        static constexpr uint32_t SLOTS = 1 << SLOT_BITS;
+        static constexpr uint32_t SLOT_MASK = SLOTS - 1;
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        struct Task
+        {
+            uint64_t priority;
+            Action   callback;
+            millisec delay;
+            millisec expiration;
+            uint32_t times;
+            uint32_t generation = 0;
+            uint32_t prev = NONE;
+            uint32_t next = NONE;
+            uint32_t level = NONE;      // NONE while the task is not linked into a slot
+            uint32_t slot = 0;
+        };
+
+        struct Slot
+        {
+            uint32_t head = NONE;
+            uint32_t tail = NONE;
+        };
+
+        struct Expired
+        {
+            uint32_t index;
+            uint32_t generation;
+        };
+
+        void insert(uint32_t index);
+        void unlink(uint32_t index);
+        void release(uint32_t index);
+        void cascade(uint32_t level, uint32_t index);
+        void expire(millisec now);
+
+        // Stable addresses, a callback may set new timers while it is running
+        std::deque<Task> tasks;
+        std::vector<uint32_t> freeTasks;
+        std::vector<Expired> expired;
 
-        static inline std::deque<Task_ptr> schedule;
-        static inline uint64_t count = 0;
+        Slot slots[LEVELS][SLOTS];
+        uint32_t levelSize[LEVELS] = {};
+
+        millisec next = 0;      // First millisecond not processed yet
+        uint64_t count = 0;
+        size_t activeCount = 0;
+        uint32_t running = NONE;
+    };
+
+    class TimeDomain;
+
+    // Timers on a time domain, game time unless another domain is given.
+    // They fire while the domain is advanced by the game loop, see Time.h.
+    class Timer
+    {
+    public:
+        typedef TimerWheel::Action Action;
+        typedef TimerWheel::Handle Handle;
+        typedef Clock::millisec millisec;
 
-        static void add(Task_ptr newTask);
+        static Handle set(Action callback, millisec delay, uint32_t times = 1, TimeDomain* domain = nullptr);
+        static bool cancel(Handle handle, TimeDomain* domain = nullptr);
+        static bool empty(TimeDomain* domain = nullptr);
     };
 }
@@ -3,6 +3,7 @@
 #include "../Core/Clock.h"
 #include "../Core/Logger.h"
 #include "../Core/Keyboard.h"
+#include "../Core/Metrics.h"
 #include "../Core/Profiler.h"
 
 #define SAFE_RELEASE(res) if (res) { res->Release(); res = nullptr; }
@@ -168,51 +169,16 @@ inline XMMATRIX XM_CALLCONV LHXMMatrixTranslation(const Vec3f& location) noexcep
     return XMMatrixTranslation(location.x, location.y, location.z);
 }
 
-inline XMMATRIX XM_CALLCONV LHXMMatrixTransformation(const Transform& transform) noexcept
-{
-    // M = XMMatrixScaling * XMMatrixRotationRollPitchYaw * XMMatrixTranslation;
-
-    constexpr float k = std::numbers::pi / 180.0f;
-
-    float pitch = transform.rotation.pitch * k;
-    float yaw   = transform.rotation.yaw * k;
-    float roll  = transform.rotation.roll * k;
-
-    float SP = sinf(-pitch), SY = sinf(yaw), SR = sinf(roll);
-    float CP = cosf(-pitch), CY = cosf(yaw), CR = cosf(roll);
-
-    float r0x = (CP * CY) * transform.scale.x;
-    float r0y = (CP * SY) * transform.scale.x;
-    float r0z = (SP) * transform.scale.x;
-
-    float r1x = (SR * SP * CY - CR * SY) * transform.scale.y;
-    float r1y = (SR * SP * SY + CR * CY) * transform.scale.y;
-    float r1z = (-SR * CP) * transform.scale.y;
-
-    float r2x = (-(CR * SP * CY + SR * SY)) * transform.scale.z;
-    float r2y = (CY * SR - CR * SP * SY) * transform.scale.z;
-    float r2z = (CR * CP) * transform.scale.z;
-
-    //XMMATRIX M;
-    //M.r[0] = DirectX::XMVectorSet(r0x, r0y, r0z, 0.f);
-    //M.r[1] = DirectX::XMVectorSet(r1x, r1y, r1z, 0.f);
-    //M.r[2] = DirectX::XMVectorSet(r2x, r2y, r2z, 0.f);
-    //M.r[3] = DirectX::XMVectorSet(transform.location.x, transform.location.y, transform.location.z, 1.f);
-    //return M;
-
-    // Apply XMMatrixTranspose
-    XMMATRIX M;
-    M.r[0] = DirectX::XMVectorSet(r0x, r1x, r2x, transform.location.x);
-    M.r[1] = DirectX::XMVectorSet(r0y, r1y, r2y, transform.location.y);
-    M.r[2] = DirectX::XMVectorSet(r0z, r1z, r2z, transform.location.z);
-    M.r[3] = DirectX::XMVectorSet(0.f, 0.f, 0.f, 1.f);
-    return M;
-}
-
-void DirectX::D3D11Renderer::Draw(const GameState& gameState)
+void DirectX::D3D11Renderer::Draw(const RenderList& renderList)
 {
     ProfileBlock("[Renderer] Draw");
 
+    static MetricCounter& drawCalls = Metrics::Counter("Renderer/Draw calls");
+    static MetricCounter& bytesUploaded = Metrics::Counter("Renderer/Bytes uploaded");
+    static MetricGauge& renderedObjects = Metrics::Gauge("Renderer/Rendered objects");
+    static MetricGauge& culledObjects = Metrics::Gauge("Renderer/Culled objects");
+    static MetricHistogram& indicesPerDraw = Metrics::Histogram("Renderer/Indices per draw");
+
     // PASS 1: Render scene to FXAA render target
     ID3D11RenderTargetView* currentRenderTargetView = fxaa ? fxaaRenderTargetView : renderTargetView;
     deviceContext->OMSetRenderTargets(1, &currentRenderTargetView, depthStencilView);
@@ -225,22 +191,23 @@ void DirectX::D3D11Renderer::Draw(const GameState& gameState)
 
     u32 renderCount = 0;
     u32 cullCount = 0;
+    // Recorded into the metrics once after the loop, not per draw call
+    Histogram frameIndicesPerDraw;
 
-    for (const auto& object : gameState.objects)
+    for (const auto& proxy : renderList)
     {
-        if (object->mesh == nullptr || object->mesh->data == nullptr)
+        if (proxy.meshData == nullptr)
         {
-            //log_warn("Mesh \"{}\" is not loaded into video memory", object->mesh ? object->mesh->name : "<uknown mesh name>");
             continue;
         }
 
-        if (!frustum->CheckSphere(object))
+        if (!frustum->CheckSphere(proxy.bounds))
         {
             cullCount++;
             continue;
         }
 
-        ID3D11BufferPair& meshBuffer = *(ID3D11BufferPair*)object->mesh->data;
+        ID3D11BufferPair& meshBuffer = *(ID3D11BufferPair*)proxy.meshData;
         UINT stride = sizeof(SimpleVertex);
         UINT offset = 0;
         deviceContext->IASetVertexBuffers(0, 1, &meshBuffer.first, &stride, &offset);
@@ -260,22 +227,20 @@ void DirectX::D3D11Renderer::Draw(const GameState& gameState)
         //--------------------------------------------------------------------------------------------------------------
 
         //XMMATRIX world = LHXMMatrixScaling(object->transform.scale) * LHXMMatrixRotationRollPitchYaw(object->transform.rotation) * LHXMMatrixTranslation(object->transform.location);
-        //XMMATRIX world = LHXMMatrixTransformation(object->transform); // ~40% faster than above
-
-        float tintColor[4] = { 1.0f, 1.0f, 1.0f, object->useTintColor ? 1.0f : 0.0f };
-        memcpy(tintColor, object->tintColor, sizeof(float) * 3);
+        XMMATRIX world = XMLoadFloat4x4((const XMFLOAT4X4*)&proxy.world); // Core::WorldMatrix, ~40% faster than above
 
         ConstantBuffer cb = {
-          .world      = LHXMMatrixTransformation(object->transform), //XMMatrixTranspose(world),
+          .world      = world, //XMMatrixTranspose(world),
           .view       = XMMatrixTranspose(view),
           .projection = XMMatrixTranspose(projection),
-          .tintColor  = XMFLOAT4(tintColor),
+          .tintColor  = XMFLOAT4(proxy.tintColor),
         };
         deviceContext->UpdateSubresource(constantBuffer, 0, nullptr, &cb, 0, 0);
-        deviceContext->DrawIndexed(object->mesh->indices.size(), 0, 0);
+        deviceContext->DrawIndexed(proxy.indexCount, 0, 0);
+        frameIndicesPerDraw.Record(proxy.indexCount);
 
 #if defined(DEVELOPER)
-        if (object->selected && false)
+        if (proxy.selected && false)
         {
             //deviceContext->VSSetShader(vertexShader, nullptr, 0);
             deviceContext->GSSetShader(wireframeGShader, nullptr, 0);
@@ -284,10 +249,8 @@ void DirectX::D3D11Renderer::Draw(const GameState& gameState)
             deviceContext->GSSetConstantBuffers(0, 1, &wireframeCBuffer);
             deviceContext->PSSetConstantBuffers(0, 1, &wireframeCBuffer);
 
-            Transform wireframe = object->transform;
-            wireframe.scale.x += 0.001f;
-            wireframe.scale.y += 0.001f;
-            wireframe.scale.z += 0.001f;
+            // Slightly inflated so the wireframe does not z-fight with the mesh
+            XMMATRIX wireframe = XMMatrixMultiply(world, XMMatrixScaling(1.001f, 1.001f, 1.001f));
 
             float time = Clock::now() / 1000.0f;
             float blinksPerSecond = 1.0f;
@@ -295,14 +258,14 @@ void DirectX::D3D11Renderer::Draw(const GameState& gameState)
             float wireframeColor[4] = { blinkFactor, 0.0f, blinkFactor, 1.0f };
 
             WireframeCBuffer cb = {
-              .world = LHXMMatrixTransformation(wireframe),
+              .world = wireframe,
               .view = XMMatrixTranspose(view),
               .projection = XMMatrixTranspose(projection),
               .wireframeColor = XMFLOAT4(wireframeColor),
             };
             deviceContext->UpdateSubresource(wireframeCBuffer, 0, nullptr, &cb, 0, 0);
 
-            deviceContext->DrawIndexed(object->mesh->indices.size(), 0, 0);
+            deviceContext->DrawIndexed(proxy.indexCount, 0, 0);
 
             deviceContext->GSSetShader(nullptr, nullptr, 0);
             deviceContext->VSSetConstantBuffers(0, 1, &constantBuffer);
@@ -314,6 +277,11 @@ void DirectX::D3D11Renderer::Draw(const GameState& gameState)
 
     this->rendered = renderCount;
     this->culled = cullCount;
+    renderedObjects.Set(renderCount);
+    culledObjects.Set(cullCount);
+    drawCalls.Add(renderCount);
+    bytesUploaded.Add((i64)renderCount * sizeof(ConstantBuffer));
+    indicesPerDraw.Record(frameIndicesPerDraw);
 
     // PASS 2: Apply FXAA and render to back buffer
     if (fxaa) RenderPassFXAA(renderTargetView);
@@ -24,7 +24,7 @@ namespace DirectX
 		virtual void LoadMesh(const MeshRef& mesh) override;
 		virtual void UnloadMesh(const MeshRef& mesh) override;
 		virtual void Clear(const rgba color) override;
-		virtual void Draw(const GameState&) override;
+		virtual void Draw(const RenderList&) override;
 		virtual void Present() override;
 		virtual void SetVSync(bool enabled) override;
 		virtual void SetFXAA(bool enabled) override;
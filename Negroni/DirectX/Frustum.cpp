@@ -108,21 +108,9 @@ bool DirectX::Frustum::CheckCube(float xCenter, float yCenter, float zCenter, fl
 	return true;
 }
 
-bool DirectX::Frustum::CheckSphere(const ObjectRef& object)
+bool DirectX::Frustum::CheckSphere(const Sphere& sphere)
 {
-	// Performance optimization
-	const Sphere& sphere = object->mesh->boundingSphere;
-	const Vec3f& location = object->transform.location;
-	const Vec3f& scale = object->transform.scale;
-
-	const float xCenter = sphere.center.x + location.x;
-	const float yCenter = sphere.center.y + location.y;
-	const float zCenter = sphere.center.z + location.z;
-
-	float scaleFactor = scale.x > scale.y ? scale.x : scale.y;
-	scaleFactor = scaleFactor > scale.z ? scaleFactor : scale.z;
-
-	return Frustum::CheckSphere(xCenter, yCenter, zCenter, sphere.radius * scaleFactor);
+	return Frustum::CheckSphere(sphere.center.x, sphere.center.y, sphere.center.z, sphere.radius);
 }
 
 bool DirectX::Frustum::CheckSphere(float xCenter, float yCenter, float zCenter, float radius)
@@ -17,7 +17,7 @@ namespace DirectX
 		bool CheckSphere(float, float, float, float);
 		bool CheckRectangle(float, float, float, float, float, float);
 
-		bool CheckSphere(const ObjectRef&);
+		bool CheckSphere(const Sphere&);
 
 	private:
 		XMVECTOR planes[6];
@@ -17,7 +17,7 @@ namespace Negroni
             log_info("editor script consturctor");
         }
 
-        void FixedUpdate() override
+        void FixedUpdate(float) override
         {
         }
 
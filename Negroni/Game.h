@@ -6,6 +6,7 @@
 
 #include "Core/Base.h"
 #include "Core/GameLoop.h"
+#include "Core/JobSystem.h"
 #include "Core/Logger.h"
 #include "Core/Keyboard.h"
 //#include "Core/CubeMesh.h"
@@ -86,6 +87,9 @@ namespace Negroni
             //numThreads = omp_get_max_threads() / 2;
             log_info("threads in use: {}", numThreads);
 
+            // The thread running the game loop helps too, so it is not counted as a worker
+            JobSystem::Start(numThreads > 1 ? numThreads - 1 : 0);
+
             //objects.reserve(1'00'000);
             //for (int i = 0; i < objects.capacity(); ++i)
             //{
@@ -95,6 +99,11 @@ namespace Negroni
             //physics.Add(&cube);
         }
 
+        ~Game()
+        {
+            JobSystem::Stop();
+        }
+
     private:
         //PhysX     physics;
         u8        numThreads;
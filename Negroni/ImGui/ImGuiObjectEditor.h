@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../Core/Gui.h"
+#include "../Core/ObjectInspector.h"
 #include "imgui.h"
 
 #include <format>
@@ -18,10 +19,11 @@ namespace ImGui
 
         virtual void Draw() override;
 
-        void SetObject(const ObjectRef& object);
+        // The editor never touches the object, it shows the inspector's snapshots and sends edits
+        void SetInspector(ObjectInspector& inspector);
 
     private:
-        ObjectRef object = nullptr;
+        ObjectInspector* inspector = nullptr;
     };
 }
 
@@ -41,9 +43,12 @@ void ImGui::ImGuiObjectEditor::Draw()
     windowFlags |= ImGuiWindowFlags_NoNavInputs;
     bool open = true;
 
-    if (!object) return;
+    if (!inspector) return;
 
-    str id = std::format("{:08}", (u32)object->id);
+    const ObjectSnapshot& object = inspector->Read();
+    if (object.id == ID::None) return;
+
+    str id = std::format("{:08}", (u32)object.id);
     str formattedId = std::format("{}-{}", id.substr(0, 3), id.substr(3, 5));
     str title = std::format("Object #{}", formattedId);
 
@@ -66,7 +71,7 @@ void ImGui::ImGuiObjectEditor::Draw()
             {
                 ImGui::AlignTextToFramePadding();
                 static const char* LocationText = "X:  %.2f\nY:  %.2f\nZ:  %.2f";
-                ImGui::Text(LocationText, object->transform.location.x, object->transform.location.y, object->transform.location.z);
+                ImGui::Text(LocationText, object.transform.location.x, object.transform.location.y, object.transform.location.z);
             }
 
             ImGui::TableNextRow();
@@ -80,7 +85,7 @@ void ImGui::ImGuiObjectEditor::Draw()
             {
                 ImGui::AlignTextToFramePadding();
                 static const char* RotationText = "P:  %.1f\nY:  %.1f\nR:  %.1f";
-                ImGui::Text(RotationText, object->transform.rotation.pitch, object->transform.rotation.yaw, object->transform.rotation.roll);
+                ImGui::Text(RotationText, object.transform.rotation.pitch, object.transform.rotation.yaw, object.transform.rotation.roll);
             }
 
             ImGui::TableNextRow();
@@ -94,7 +99,7 @@ void ImGui::ImGuiObjectEditor::Draw()
             {
                 ImGui::AlignTextToFramePadding();
                 static const char* ScaleText = "X:  %.1f\nY:  %.1f\nZ:  %.1f\n\n";
-                ImGui::Text(ScaleText, object->transform.scale.x, object->transform.scale.y, object->transform.scale.z);
+                ImGui::Text(ScaleText, object.transform.scale.x, object.transform.scale.y, object.transform.scale.z);
             }
 
             ImGui::TableNextRow();
@@ -105,7 +110,9 @@ void ImGui::ImGuiObjectEditor::Draw()
             }
             ImGui::TableSetColumnIndex(1);
             {
-                ImGui::Checkbox("##use_tint_color", &object->useTintColor);
+                ObjectEdit edit = { (u32)object.id, object.useTintColor };
+                memcpy(edit.tintColor, object.tintColor, sizeof(RGB));
+                if (ImGui::Checkbox("##use_tint_color", &edit.useTintColor)) inspector->Edit(edit);
             }
 
             ImGui::TableNextRow();
@@ -116,7 +123,9 @@ void ImGui::ImGuiObjectEditor::Draw()
             }
             ImGui::TableSetColumnIndex(1);
             {
-                ImGui::ColorEdit3("Tint Color", object->tintColor, ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoLabel);
+                ObjectEdit edit = { (u32)object.id, object.useTintColor };
+                memcpy(edit.tintColor, object.tintColor, sizeof(RGB));
+                if (ImGui::ColorEdit3("Tint Color", edit.tintColor, ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoLabel)) inspector->Edit(edit);
             }
 
             ImGui::TableNextRow();
@@ -129,7 +138,7 @@ void ImGui::ImGuiObjectEditor::Draw()
             ImGui::TableSetColumnIndex(1);
             {
                 ImGui::AlignTextToFramePadding();
-                ImGui::Text(object->mesh ? object->mesh->name.c_str() : "<NULL>");
+                ImGui::Text("%s", object.meshName.c_str());
             }
 
             ImGui::TableNextRow();
@@ -142,7 +151,7 @@ void ImGui::ImGuiObjectEditor::Draw()
             ImGui::TableSetColumnIndex(1);
             {
                 ImGui::AlignTextToFramePadding();
-                ImGui::Text(object->script->Name().c_str());
+                ImGui::Text("%s", object.scriptName.c_str());
             }
 
             ImGui::EndTable();
@@ -156,7 +165,7 @@ void ImGui::ImGuiObjectEditor::Draw()
     ImGui::End();
 }
 
-void ImGui::ImGuiObjectEditor::SetObject(const ObjectRef& object)
+void ImGui::ImGuiObjectEditor::SetInspector(ObjectInspector& inspector)
 {
-    this->object = object;
+    this->inspector = &inspector;
 }
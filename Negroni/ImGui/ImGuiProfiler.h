@@ -1,10 +1,14 @@
 #pragma once
 
 #include "../Core/Gui.h"
+#include "../Core/Metrics.h"
+#include "../Core/AllocationTracker.h"
 #include "imgui.h"
 
 #include <format>
 #include <functional>
+#include <mutex>
+#include <vector>
 
 using namespace Core;
 
@@ -18,8 +22,20 @@ namespace ImGui
 
         virtual void Draw() override;
 
+        // Show the busy/wait split of a pipelined thread. Safe while the GUI is drawn on another thread.
+        void Watch(const char* name, const ThreadFrameStats* stats);
+        void Unwatch();
+
     private:
-        u32 DrawProfilerEntry(u32 index = 0);
+        u32 DrawProfilerEntry(const std::vector<ProfileLane::Entry>& entries, u32 index = 0, u32 indent = 0);
+        void DrawTimeline(const std::vector<ProfileLane>& lanes);
+        void DrawScopeStats();
+        void DrawMetrics();
+        void DrawAllocations();
+        void DrawThreadStats();
+
+        std::mutex threadsMutex;
+        std::vector<std::pair<const char*, const ThreadFrameStats*>> threads;
     };
 }
 
@@ -45,28 +61,27 @@ void ImGui::ImGuiProfiler::Draw()
 
     ImGui::Begin("Profiler", NULL /*&open*/, windowFlags);
     {
+        const auto& lanes = Profiler::Lanes();
+
+        // The longest thread frame bounds the frame time
         static float values[60] = {};
         static float totalElapsed = 0.0f;
         static int values_offset = 0;
         static float maxPlotY = 0.0f;
         static double refresh_time = ImGui::GetTime();
-        if (Profiler::size > 1 && ((ImGui::GetTime() - refresh_time) > (1.0f / 60.0f)))
+        if (!lanes.empty() && ((ImGui::GetTime() - refresh_time) > (1.0f / 60.0f)))
         {
             totalElapsed = 0.0f;
-            for (int i = 0; i < Profiler::size; ++i)
+            for (auto& lane : lanes)
             {
-                auto& entry = Profiler::entries[i];
-                if (entry.indent == 0)
-                {
-                    totalElapsed += entry.elapsed / 1000.0f;
-                }
+                totalElapsed = std::max(totalElapsed, lane.TotalMs());
             }
             values_offset = (values_offset + 1) % IM_ARRAYSIZE(values);
             values[values_offset] = totalElapsed;
             refresh_time = ImGui::GetTime();
         }
 
-        str overlayText = std::format("Total elapsed ({:.3f} ms)", totalElapsed);
+        str overlayText = std::format("Longest thread ({:.3f} ms)", totalElapsed);
         float max = *std::max_element(values, values + IM_ARRAYSIZE(values));
         maxPlotY = (max * 1.5f > maxPlotY) || (max < maxPlotY / 2) ? (max * 2) : maxPlotY;
 
@@ -75,15 +90,34 @@ void ImGui::ImGuiProfiler::Draw()
         ImGui::PlotLines("##call_graph", values, IM_ARRAYSIZE(values), values_offset, overlayText.c_str(), 0.0f, maxPlotY, graphSize);
         ImGui::PopStyleColor();
 
-        if (ImGui::BeginTable("Call Graph", 2, ImGuiTableFlags_PadOuterX))
+        DrawThreadStats();
+        DrawTimeline(lanes);
+        DrawScopeStats();
+        DrawMetrics();
+        DrawAllocations();
+
+        for (auto& lane : lanes)
         {
-            ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed, 350.0f);
-            ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed);
-            //ImGui::TableHeadersRow();
+            if (lane.entries.empty()) continue;
 
-            DrawProfilerEntry();
+            ImGui::PushID((int)lane.thread);
+            str header = lane.dropped ? std::format("{} ({:.3f} ms, {} events dropped)", lane.name, lane.TotalMs(), lane.dropped)
+                                      : std::format("{} ({:.3f} ms)", lane.name, lane.TotalMs());
+            if (ImGui::TreeNodeEx(header.c_str(), ImGuiTreeNodeFlags_DefaultOpen))
+            {
+                if (ImGui::BeginTable("Call Graph", 2, ImGuiTableFlags_PadOuterX))
+                {
+                    ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed, 350.0f);
+                    ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed);
+                    //ImGui::TableHeadersRow();
 
-            ImGui::EndTable();
+                    DrawProfilerEntry(lane.entries);
+
+                    ImGui::EndTable();
+                }
+                ImGui::TreePop();
+            }
+            ImGui::PopID();
         }
 
         //ImVec2 windowSize = ImGui::GetWindowSize();
@@ -94,70 +128,246 @@ void ImGui::ImGuiProfiler::Draw()
     ImGui::End();
 }
 
-u32 ImGui::ImGuiProfiler::DrawProfilerEntry(u32 index)
+void ImGui::ImGuiProfiler::Watch(const char* name, const ThreadFrameStats* stats)
+{
+    std::lock_guard<std::mutex> guard(threadsMutex);
+    threads.emplace_back(name, stats);
+}
+
+void ImGui::ImGuiProfiler::Unwatch()
 {
-    for (int i = index; i < Profiler::size - 1; ++i)
+    std::lock_guard<std::mutex> guard(threadsMutex);
+    threads.clear();
+}
+
+void ImGui::ImGuiProfiler::DrawThreadStats()
+{
+    std::lock_guard<std::mutex> guard(threadsMutex);
+    if (threads.empty()) return;
+
+    if (ImGui::BeginTable("Threads", 4, ImGuiTableFlags_PadOuterX))
     {
-        ImGui::TableNextRow();
-        ImGui::TableNextColumn();
+        ImGui::TableSetupColumn("Thread", ImGuiTableColumnFlags_WidthFixed, 200.0f);
+        ImGui::TableSetupColumn("Busy", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Waiting", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Frames", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableHeadersRow();
+
+        for (auto& [name, stats] : threads)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f ms", stats->busyMs.load());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f ms", stats->waitMs.load());
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", stats->frames.load());
+        }
 
-        auto& entry = Profiler::entries[i];
-        str entryName = std::format("{}  ", entry.name.c_str());
-        const bool isFolder = entry.indent < Profiler::entries[i + 1].indent;
-        const bool isFinite = Profiler::entries[i + 1].indent < entry.indent;
+        ImGui::EndTable();
+    }
+}
+
+void ImGui::ImGuiProfiler::DrawTimeline(const std::vector<ProfileLane>& lanes)
+{
+    // One lane per thread on a shared time axis, nested blocks stacked below their parent
+    u64 begin = UINT64_MAX;
+    u64 end = 0;
+    for (auto& lane : lanes)
+    {
+        if (lane.entries.empty()) continue;
+        begin = std::min(begin, lane.start);
+        end = std::max(end, lane.end);
+    }
+    if (begin >= end) return;
 
-        static ImGuiTreeNodeFlags nodeFlags = ImGuiTreeNodeFlags_SpanAllColumns | ImGuiTreeNodeFlags_DrawLinesFull;
-        if (i != 0)
-            nodeFlags &= ~ImGuiTreeNodeFlags_LabelSpanAllColumns;
+    static const ImU32 colors[] = {
+        IM_COL32(230, 180, 50, 255),
+        IM_COL32(80, 160, 220, 255),
+        IM_COL32(110, 190, 110, 255),
+        IM_COL32(200, 110, 160, 255),
+    };
 
-        if (isFolder)
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    const float width = std::max(ImGui::GetContentRegionAvail().x, 400.0f);
+    const float rowHeight = ImGui::GetTextLineHeight() + 2.0f;
+    const double scale = width / double(end - begin);
+
+    for (auto& lane : lanes)
+    {
+        if (lane.entries.empty()) continue;
+
+        ImGui::TextDisabled("%s", lane.name.c_str());
+        const ImVec2 origin = ImGui::GetCursorScreenPos();
+
+        u32 depth = 0;
+        for (auto& entry : lane.entries)
         {
-            bool open = ImGui::TreeNodeEx(entryName.c_str(), nodeFlags);
-            if ((nodeFlags & ImGuiTreeNodeFlags_LabelSpanAllColumns) == 0)
+            depth = std::max(depth, entry.indent + 1);
+
+            ImVec2 min(origin.x + float((entry.start - begin) * scale), origin.y + entry.indent * rowHeight);
+            ImVec2 max(std::max(min.x + 1.0f, origin.x + float((entry.start + entry.elapsed - begin) * scale)), min.y + rowHeight - 1.0f);
+            drawList->AddRectFilled(min, max, colors[entry.indent % IM_ARRAYSIZE(colors)]);
+
+            if (ImGui::CalcTextSize(entry.site->name).x + 4.0f < max.x - min.x)
+                drawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32(20, 20, 20, 255), entry.site->name);
+
+            if (ImGui::IsMouseHoveringRect(min, max))
+                ImGui::SetTooltip("%s\n%.3f ms\n%s:%u", entry.site->name, entry.elapsed / 1e6f, entry.site->file, entry.site->line);
+        }
+
+        ImGui::Dummy(ImVec2(width, depth * rowHeight));
+    }
+}
+
+void ImGui::ImGuiProfiler::DrawScopeStats()
+{
+    const auto& stats = Profiler::ScopeStats();
+    if (stats.empty()) return;
+
+    constexpr float WINDOW_SECONDS = PROFILER_STAT_SLICES * PROFILER_STAT_SLICE_FRAMES / 60.0f;
+    str header = std::format("Scope statistics (~{:.0f} s)", WINDOW_SECONDS);
+    if (!ImGui::CollapsingHeader(header.c_str())) return;
+
+    if (ImGui::BeginTable("Scope Stats", 8, ImGuiTableFlags_PadOuterX | ImGuiTableFlags_RowBg))
+    {
+        ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthFixed, 200.0f);
+        ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Min", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Mean", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("p50", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("p95", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("p99", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Max", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableHeadersRow();
+
+        for (auto& scope : stats)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", scope.site->name);
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("%s:%u", scope.site->file, scope.site->line);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", scope.count);
+            for (double value : { (double)scope.min, scope.mean, (double)scope.p50, (double)scope.p95, (double)scope.p99, (double)scope.max })
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f ms", value / 1e6);
+            }
+        }
+
+        ImGui::EndTable();
+    }
+}
+
+void ImGui::ImGuiProfiler::DrawMetrics()
+{
+    auto metrics = Metrics::All();
+    if (metrics.empty() || !ImGui::CollapsingHeader("Metrics")) return;
+
+    const ImVec2 plotSize(std::max(ImGui::GetContentRegionAvail().x, 400.0f), 40.0f);
+    for (Metric* metric : metrics)
+    {
+        str overlay;
+        switch (metric->Kind())
+        {
+        case MetricKind::Counter:
+            overlay = std::format("{}: {:.0f} (total {})", metric->Name(), metric->Last(), ((MetricCounter*)metric)->Total());
+            break;
+        case MetricKind::Gauge:
+            overlay = std::format("{}: {:.2f}", metric->Name(), metric->Last());
+            break;
+        case MetricKind::Histogram:
+        {
+            const Histogram& frame = ((MetricHistogram*)metric)->LastFrame();
+            overlay = std::format("{}: n={} mean={:.1f} p50={} p95={} max={}", metric->Name(), frame.Count(), frame.Mean(), frame.Percentile(50.0), frame.Percentile(95.0), frame.Max());
+            break;
+        }
+        }
+
+        const float* history = metric->History();
+        float max = *std::max_element(history, history + METRIC_HISTORY);
+
+        ImGui::PushID(metric);
+        ImGui::PlotLines("##metric", history, METRIC_HISTORY, metric->HistoryOffset(), overlay.c_str(), 0.0f, std::max(max * 1.2f, 1.0f), plotSize);
+        ImGui::PopID();
+    }
+}
+
+void ImGui::ImGuiProfiler::DrawAllocations()
+{
+    if (!AllocationTracker::Enabled()) return;
+
+    str header = std::format("Allocations ({} this frame, {} bytes, {} frees)###Allocations",
+        AllocationTracker::FrameAllocations(), AllocationTracker::FrameBytes(), AllocationTracker::FrameFrees());
+    if (!ImGui::CollapsingHeader(header.c_str())) return;
+
+    ImGui::Text("Frames without allocations: %llu", AllocationTracker::QuietFrames());
+
+    if (ImGui::BeginTable("Top Allocating Scopes", 5, ImGuiTableFlags_PadOuterX | ImGuiTableFlags_RowBg))
+    {
+        ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthFixed, 200.0f);
+        ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Bytes", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Total count", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Total bytes", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableHeadersRow();
+
+        for (auto& scope : AllocationTracker::TopScopes())
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", scope.site ? scope.site->name : "(no scope)");
+            if (scope.site && ImGui::IsItemHovered()) ImGui::SetTooltip("%s:%u", scope.site->file, scope.site->line);
+            for (u64 value : { scope.count, scope.bytes, scope.totalCount, scope.totalBytes })
             {
                 ImGui::TableNextColumn();
-                ImGui::Text("%.3f ms", entry.elapsed / 1000.0f);
+                ImGui::Text("%llu", value);
             }
+        }
+
+        ImGui::EndTable();
+    }
+}
+
+u32 ImGui::ImGuiProfiler::DrawProfilerEntry(const std::vector<ProfileLane::Entry>& entries, u32 index, u32 indent)
+{
+    static ImGuiTreeNodeFlags nodeFlags = ImGuiTreeNodeFlags_SpanAllColumns | ImGuiTreeNodeFlags_DrawLinesFull;
+
+    while (index < entries.size() && entries[index].indent == indent)
+    {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+
+        auto& entry = entries[index];
+        str entryName = std::format("{}  ", entry.site->name);
+        const bool isFolder = index + 1 < entries.size() && entries[index + 1].indent > indent;
+
+        if (isFolder)
+        {
+            bool open = ImGui::TreeNodeEx(entryName.c_str(), nodeFlags);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f ms", entry.elapsed / 1e6f);
 
             if (open)
             {
-                i = DrawProfilerEntry(i + 1);
+                index = DrawProfilerEntry(entries, index + 1, indent + 1);
                 ImGui::TreePop();
             }
             else
             {
-                for (int n = i + 1; n < Profiler::size - 1 && Profiler::entries[n].indent > entry.indent; ++n)
-                {
-                    i++;
-                }
+                for (++index; index < entries.size() && entries[index].indent > indent; ++index) {}
             }
         }
         else
         {
             ImGui::TreeNodeEx(entryName.c_str(), nodeFlags | ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen);
             ImGui::TableNextColumn();
-            ImGui::Text("%.3f ms", entry.elapsed / 1000.0f);
-
-            if (isFinite) return i;
-        }
-
-        const u32 lastEntryIndex = Profiler::size - 1;
-        const bool isNextEntryLast = i + 1 == lastEntryIndex;
-        const bool drawLastEntry = isNextEntryLast && Profiler::entries[i + 1].indent == entry.indent;
-        if (drawLastEntry)
-        {
-            ImGui::TableNextRow();
-            ImGui::TableNextColumn();
-
-            auto& entry = Profiler::entries[i + 1];
-            str name = std::format("{}  ", entry.name.c_str());
-            ImGui::TreeNodeEx(name.c_str(), nodeFlags | ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen);
-            ImGui::TableNextColumn();
-            ImGui::Text("%.3f ms", entry.elapsed / 1000.0f);
-
+            ImGui::Text("%.3f ms", entry.elapsed / 1e6f);
+            ++index;
         }
-
-        index = i;
     }
 
     return index;
@@ -6,6 +6,9 @@
 #include "Core/Clock.h"
 #include "Core/SwapChain.h"
 #include "Core/Logger.h"
+#include "Core/Metrics.h"
+#include "Core/AllocationTracker.h"
+#include "Core/Telemetry.h"
 #include "Core/Input.h"
 #include "Core/Keyboard.h"
 #include "Core/Mouse.h"
@@ -46,9 +49,41 @@ namespace LMD
 	public:
 		Lemonade(u32 width, u32 height, const wstr& name) : width(width), height(height), name(name) {};
 
+		// Run the simulation and the rendering on separate threads, with the game
+		// at most `frameLatency` (1-3) frames ahead of the presented one
+		bool pipelined = false;
+		u32  frameLatency = 2;
+
+		// Crash-safe copy of the log, decoded with the FlightDecoder tool. nullptr turns it off.
+		const char* flightRecorderPath = "Negroni.flight";
+
+		// Shared memory segment read by the TelemetryMonitor tool. nullptr turns it off.
+		const char* telemetryName = TELEMETRY_NAME;
+
+		// Profiler capture written as Chrome trace JSON, started by the CaptureTrace key
+		// or, when traceFrames is set, right at startup
+		u32 traceFrames = 0;
+		u32 traceKeyFrames = 300;
+		str tracePath = "Negroni.trace.json";
+
+		// Frames around a hitch are dumped as Chrome traces, always on when profiling
+		ProfileSpikeSettings spikes = { .budgetMs = 50.0f, .medianMultiple = 4.0f };
+
 		int exec()
 		{
             //startLogger();
+            ProfileThread("Main thread");
+            if (flightRecorderPath && !FlightRecorder::Open(flightRecorderPath))
+            {
+                log_warn("Can't open the flight recorder file {}", flightRecorderPath);
+            }
+            if (telemetryName && !Telemetry::Open(telemetryName))
+            {
+                log_warn("Can't open the telemetry segment {}", telemetryName);
+            }
+#if defined(PROFILER_ENABLED)
+            Profiler::DetectSpikes(spikes);
+#endif
 
 #if defined(OS_WINDOWS)
             Windows::Win32Window window(width, height, name);
@@ -75,11 +110,12 @@ namespace LMD
 
             ImGui::LmdImGui gui(imGuiPlatform, imGuiRenderer);
 
-            bool running = true;
+            // Cleared by the Quit key callback, which may run on the game thread
+            std::atomic<bool> running = true;
 
             ActionKeyMap keyBindings = KeyValueFile::Read("KeyBindings.kvl");
             Input::UseKeyBindings(keyBindings);
-            Keyboard::OnPress("Quit") = [&running]() { running = false; };
+            Keyboard::OnPress("Quit") = [&running]() { running.store(false, std::memory_order_relaxed); };
             //Keyboard::Listen("Jump", [](const str& key) { log_info("new Jump key: {}", key); });
             Mouse::UseKeyBindings(keyBindings);
 
@@ -93,14 +129,18 @@ namespace LMD
             gui.Add(&profiler);
 
             Keyboard::OnPress("ToggleDemoUI") = [&imGuiDemo, &objectEditor]() {
-                imGuiDemo.visible    = !imGuiDemo.visible;
-                objectEditor.visible = !objectEditor.visible;
+                imGuiDemo.visible.store(!imGuiDemo.visible.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                objectEditor.visible.store(!objectEditor.visible.load(std::memory_order_relaxed), std::memory_order_relaxed);
             };
+            Keyboard::OnPress("CaptureTrace") = [this]() { Profiler::StartCapture(traceKeyFrames, tracePath); };
+
+            if (traceFrames) Profiler::StartCapture(traceFrames, tracePath);
 #endif
 
             Negroni::Game game;
 
-            objectEditor.SetObject(game.state.objects[0]);
+            game.inspector.SetObject(game.state.objects[0]);
+            objectEditor.SetInspector(game.inspector);
 
             for (auto& object : game.state.objects)
             {
@@ -110,30 +150,85 @@ namespace LMD
             renderer.SetVSync(true);
             window.Show();
 
-            //RenderThread renderThread(renderer, gui);
-            //GameThread gameThread(game, std::bind(&RenderThread::Draw, &renderThread, _1));
-
-            //const float color[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
-            constexpr float HEX_0C = 12.0f / 255.0f;
-            const float color[4] = { HEX_0C, HEX_0C, HEX_0C, 1.0f };
-
-            while (running)
+            if (pipelined)
             {
-                if (window.Closed()) break;
+                RenderThread renderThread(renderer, gui, frameLatency);
+                GameThread gameThread(game, std::bind(&RenderThread::Draw, &renderThread, _1));
 
-                auto input = window.ReadInput();
-                auto dt = Lemonade::DeltaTime();
-                auto& state = game.Update(input, dt);
+                // The renderer and ImGui now live on the render thread
+                auto onResized = window.OnResized;
+                window.OnResized = std::bind(&RenderThread::Resize, &renderThread, _1, _2);
+#if defined(OS_WINDOWS)
+                auto onWndProc = window.OnWndProc;
+                window.OnWndProc = [&imGuiPlatform, &renderThread](HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+                    std::lock_guard<std::mutex> guard(renderThread.GuiMutex());
+                    return imGuiPlatform.WndProc(hWnd, msg, wParam, lParam);
+                };
+#endif
 
-                //gameThread.Update(input);
-                //renderThread.Draw(state);
+#if defined(DEVELOPER)
+                profiler.Watch("Game thread", &gameThread.Stats());
+                profiler.Watch("Render thread", &renderThread.Stats());
+#endif
 
-                renderer.Clear((rgba)color);
-                renderer.Draw(state);
-                gui.Draw();
-                renderer.Present();
+                while (running.load(std::memory_order_relaxed))
+                {
+                    if (window.Closed()) break;
+
+                    // Paced by the game thread, but never blocked for long: the render thread's
+                    // Present() may need this thread to handle window messages
+                    gameThread.Update(window.ReadInput());
+                    gameThread.WaitFrame();
+                }
+
+                // The render thread goes first, which makes a Draw() the game thread is blocked in
+                // return. Both may still wait in Present() for window messages, so keep pumping.
+                renderThread.RequestStop();
+                gameThread.RequestStop();
+                while (!gameThread.Exited() || !renderThread.Exited())
+                {
+                    window.ReadInput();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                gameThread.Stop();
+                renderThread.Stop();
 
-                ProfileClear();
+#if defined(DEVELOPER)
+                profiler.Unwatch();
+#endif
+                window.OnResized = onResized;
+#if defined(OS_WINDOWS)
+                window.OnWndProc = onWndProc;
+#endif
+            }
+            else
+            {
+                //const float color[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+                constexpr float HEX_0C = 12.0f / 255.0f;
+                const float color[4] = { HEX_0C, HEX_0C, HEX_0C, 1.0f };
+                RenderList renderList;
+
+                while (running.load(std::memory_order_relaxed))
+                {
+                    if (window.Closed()) break;
+
+                    auto input = window.ReadInput();
+                    auto dt = game.frameTime.Tick();
+                    game.Update(input, dt);
+                    game.ExtractRenderList(renderList);
+
+                    renderer.Clear((rgba)color);
+                    renderer.Draw(renderList);
+                    gui.Draw();
+                    renderer.Present();
+
+                    ProfileFrame();
+                    Profiler::Collect();
+                    AllocationTracker::Frame();
+                    JobSystem::Frame();
+                    Metrics::Sample();
+                    Telemetry::Publish();
+                }
             }
 
             renderer.Cleanup();
@@ -144,30 +239,13 @@ namespace LMD
             }
             window.Cleanup();
 
-            //gameThread.Stop();
-            //renderThread.Stop();
-
+            Profiler::Shutdown();
             //stopLogger();
 
             return 0;
 		}
 
 	private:
-        static float DeltaTime()
-        {
-            static u64 timeStart = Clock::now();
-            static u64 timeCur = Clock::now();
-            static float t = (timeCur - timeStart) / 1000.0f;
-            static float prev_t = t;
-
-            timeCur = Clock::now();
-            t = (timeCur - timeStart) / 1000.0f;
-            float dt = t - prev_t;
-            prev_t = t;
-
-            return dt;
-        }
-
 		u32 width;
 		u32 height;
 		wstr name;
@@ -112,7 +112,7 @@ void LMD::PhysX::Update(float dt)
             object->transform.location = *(Vec3f*)&shapePose.p; // TODO: set origin to the bottom of the object
             object->transform.rotation = quat2rot(shapePose.q);
 
-            log_info("transform: location{}", object->transform.location);
+            LOG_THROTTLED(LogLevel::Info, 10, "transform: location{}", object->transform.location);
         }
     }
 }
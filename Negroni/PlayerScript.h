@@ -39,6 +39,8 @@ namespace Negroni
             object->tintColor[2] = 1.0f;
 
             object->mesh = Asset::GetMesh("Capsule");
+            object->interpolate = true;
+            object->previousTransform = object->transform;
 
             memset(&gravity, 0, sizeof(Gravity));
             gravity.velocity = 0.0f;
@@ -74,11 +76,8 @@ namespace Negroni
             rotationDirection *= -1;
         }
 
-        void FixedUpdate() override
-        {
-        }
-
-        void Update(float dt) override
+        // Moves on the fixed step, drawn interpolated between the last two steps
+        void FixedUpdate(float dt) override
         {
             if (IsJumping())
             {
@@ -115,6 +114,10 @@ namespace Negroni
             object->transform.rotation.pitch = pitch >= 360.0f ? 0.0f : (pitch <= -360.0f ? 0.0f : pitch);
         }
 
+        void Update(float) override
+        {
+        }
+
         virtual str Name() override { return "PlayerScript"; }
 
         bool IsJumping() const
@@ -135,6 +135,8 @@ void Windows::Win32Window::Show()
 InputEvent Windows::Win32Window::ReadInput()
 {
     input.mouseScrollDelta = 0;
+    memset(input.keysPressed, 0, sizeof(input.keysPressed));
+    memset(input.keysReleased, 0, sizeof(input.keysReleased));
     input.isDirty = false;
 
     MSG msg;
@@ -237,6 +239,9 @@ bool Windows::Win32Window::HandleInput(UINT msg, WPARAM wParam, LPARAM lParam)
                 if (key != Key::None)
                 {
                     bool isKeyDown = (msg == WM_KEYDOWN || msg == WM_SYSKEYDOWN);
+                    // Auto-repeat sends more key downs, only the first one is an edge
+                    if (isKeyDown && !input.keysInUse[key]) input.keysPressed[key] = true;
+                    if (!isKeyDown && input.keysInUse[key]) input.keysReleased[key] = true;
                     input.keysInUse[key] = isKeyDown;
                 }
             }
@@ -266,6 +271,7 @@ bool Windows::Win32Window::HandleInput(UINT msg, WPARAM wParam, LPARAM lParam)
             { 
                 key = (GET_XBUTTON_WPARAM(wParam) == XBUTTON1) ? Key::MouseX1 : Key::MouseX2;
             }
+            if (!input.keysInUse[key]) input.keysPressed[key] = true;
             input.keysInUse[key] = true;
         } return true;
         case WM_LBUTTONUP:
@@ -281,6 +287,7 @@ bool Windows::Win32Window::HandleInput(UINT msg, WPARAM wParam, LPARAM lParam)
             {
                 key = (GET_XBUTTON_WPARAM(wParam) == XBUTTON1) ? Key::MouseX1 : Key::MouseX2;
             }
+            if (input.keysInUse[key]) input.keysReleased[key] = true;
             input.keysInUse[key] = false;
         } return true;
         case WM_MOUSEWHEEL:
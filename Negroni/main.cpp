@@ -8,11 +8,26 @@
 
 #include "Lemonade.h"
 
+#include <cstdlib>
+#include <cstring>
+
 using namespace LMD;
 
-int main(int, char**)
+int main(int argc, char** argv)
 {
+    // Before anything reads Clock::ticks(), the profiler included
+    Core::Clock::Calibrate();
+
     Lemonade app(1366, 768, L"Lemonade (DX11)");
 
+    // --trace <frames> [--trace-file <path>]: capture the first frames for chrome://tracing
+    // --spike-budget <ms>: dump a trace around every frame slower than that, 0 keeps the median check only
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--trace") == 0) app.traceFrames = (u32)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--trace-file") == 0) app.tracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--spike-budget") == 0) app.spikes.budgetMs = (float)std::atof(argv[++i]);
+    }
+
     return app.exec();
 }
@@ -0,0 +1,156 @@
+// Shows the live telemetry a running Negroni publishes in shared memory.
+//
+//   TelemetryMonitor [name] [--csv] [--interval <ms>] [--count <samples>]
+//
+// By default the terminal is redrawn with threads, metrics and the slowest scopes.
+// --csv prints one line per sample instead, for soak runs and comparing runs side by side.
+
+#include "Core/Telemetry.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace Core;
+
+// Read only, a monitor never writes into the game's memory
+static const TelemetrySegment* openSegment(const char* name)
+{
+#if defined(_WIN32)
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+    if (!mapping) return nullptr;
+
+    return (const TelemetrySegment*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(TelemetrySegment));
+#else
+    std::string path = std::string("/") + name;
+    int file = shm_open(path.c_str(), O_RDONLY, 0);
+    if (file < 0) return nullptr;
+
+    void* view = mmap(nullptr, sizeof(TelemetrySegment), PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    return view == MAP_FAILED ? nullptr : (const TelemetrySegment*)view;
+#endif
+}
+
+static const char* kindName(uint32_t kind)
+{
+    static const char* names[] = { "counter", "gauge", "histogram" };
+    return kind < std::size(names) ? names[kind] : "?";
+}
+
+static void printScreen(const TelemetrySnapshot& snapshot, uint32_t processId)
+{
+    // Home and clear, then draw top down
+    std::printf("\x1b[H\x1b[2J");
+    std::printf("Negroni (pid %u)  frame %llu  %.2f ms\n\n", processId, (unsigned long long)snapshot.frame, snapshot.frameMs);
+
+    std::printf("%-32s %10s %10s\n", "Thread", "Frame ms", "Dropped");
+    for (uint32_t i = 0; i < snapshot.threadCount; ++i)
+    {
+        auto& thread = snapshot.threads[i];
+        std::printf("%-32s %10.3f %10llu\n", thread.name, thread.frameMs, (unsigned long long)thread.dropped);
+    }
+
+    std::printf("\n%-40s %-10s %12s %14s\n", "Metric", "Kind", "Last", "Total");
+    for (uint32_t i = 0; i < snapshot.metricCount; ++i)
+    {
+        auto& metric = snapshot.metrics[i];
+        std::printf("%-40s %-10s %12.2f", metric.name, kindName(metric.kind), metric.value);
+        if (metric.kind == 0) std::printf(" %14lld", (long long)metric.total);
+        std::printf("\n");
+    }
+
+    std::printf("\n%-32s %10s %10s %10s %10s %10s\n", "Scope (ms)", "Count", "Mean", "p50", "p99", "Max");
+    for (uint32_t i = 0; i < snapshot.scopeCount; ++i)
+    {
+        auto& scope = snapshot.scopes[i];
+        std::printf("%-32s %10llu %10.3f %10.3f %10.3f %10.3f\n", scope.name, (unsigned long long)scope.count,
+            scope.mean / 1e6, scope.p50 / 1e6, scope.p99 / 1e6, scope.max / 1e6);
+    }
+    std::fflush(stdout);
+}
+
+// The header is printed again whenever the set of metrics changes
+static void printCsv(const TelemetrySnapshot& snapshot, std::string& header)
+{
+    std::string columns = "frame,nanos,frame_ms";
+    for (uint32_t i = 0; i < snapshot.threadCount; ++i) columns += std::string(",thread:") + snapshot.threads[i].name;
+    for (uint32_t i = 0; i < snapshot.metricCount; ++i) columns += std::string(",") + snapshot.metrics[i].name;
+
+    if (columns != header)
+    {
+        header = columns;
+        std::printf("%s\n", header.c_str());
+    }
+
+    std::printf("%llu,%llu,%.3f", (unsigned long long)snapshot.frame, (unsigned long long)snapshot.nanos, snapshot.frameMs);
+    for (uint32_t i = 0; i < snapshot.threadCount; ++i) std::printf(",%.3f", snapshot.threads[i].frameMs);
+    for (uint32_t i = 0; i < snapshot.metricCount; ++i) std::printf(",%g", snapshot.metrics[i].value);
+    std::printf("\n");
+    std::fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+    const char* name = TELEMETRY_NAME;
+    bool csv = false;
+    uint32_t interval = 500;
+    uint64_t count = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--csv") == 0) csv = true;
+        else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc) interval = (uint32_t)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) count = (uint64_t)std::atoll(argv[++i]);
+        else if (argv[i][0] != '-') name = argv[i];
+        else
+        {
+            std::printf("Usage: TelemetryMonitor [name] [--csv] [--interval <ms>] [--count <samples>]\n");
+            return 1;
+        }
+    }
+
+    const TelemetrySegment* segment = openSegment(name);
+    if (!segment)
+    {
+        std::printf("No telemetry segment %s, is the game running?\n", name);
+        return 1;
+    }
+    if (memcmp(segment->magic, TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC)) != 0 || segment->size != sizeof(TelemetrySegment))
+    {
+        std::printf("%s was written by a different version\n", name);
+        return 1;
+    }
+
+    // Large, keep it off the stack
+    static TelemetrySnapshot snapshot;
+    std::string header;
+    uint64_t lastFrame = 0;
+
+    for (uint64_t samples = 0; count == 0 || samples < count;)
+    {
+        // An unchanged frame number means the game is paused, stopped or gone
+        if (ReadTelemetry(*segment, snapshot) && snapshot.frame != lastFrame)
+        {
+            lastFrame = snapshot.frame;
+            if (csv) printCsv(snapshot, header);
+            else printScreen(snapshot, segment->processId);
+            ++samples;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    }
+
+    return 0;
+}
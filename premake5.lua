@@ -22,6 +22,7 @@ project "Negroni"
    filter "system:windows"
       cppdialect "C++20"
       buildoptions{"/utf-8"}
+      defines { "NOMINMAX" }
       includedirs { "%{prj.name}/ImGui/Vendor", "%{prj.name}/ImGui/Vendor/backends" }
       libdirs "$(DXSDK_DIR)/Lib/x64"
       links { "d3d11", "d3dcompiler", "dxgi" }
@@ -33,3 +34,83 @@ project "Negroni"
    filter "configurations:Release"
       defines { "NDEBUG", "_RELEASE", "RELEASE" }
       optimize "On"
+
+project "FlightDecoder"
+   location "FlightDecoder"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++20"
+   objdir ("obj/" .. outputdir .. "/%{prj.name}")
+   targetdir ("build/" .. outputdir .. "/%{prj.name}")
+
+   files { "%{prj.name}/**.cpp" }
+   includedirs { "Negroni" }
+
+   filter "system:windows"
+      buildoptions{"/utf-8"}
+
+   filter "configurations:Debug"
+      defines { "DEBUG", "_DEBUG" }
+      symbols "On"
+
+   filter "configurations:Release"
+      defines { "NDEBUG", "_RELEASE", "RELEASE" }
+      optimize "On"
+
+project "TelemetryMonitor"
+   location "TelemetryMonitor"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++20"
+   objdir ("obj/" .. outputdir .. "/%{prj.name}")
+   targetdir ("build/" .. outputdir .. "/%{prj.name}")
+
+   files { "%{prj.name}/**.cpp" }
+   includedirs { "Negroni" }
+
+   filter "system:windows"
+      buildoptions{"/utf-8"}
+
+   filter "system:linux"
+      links { "rt" }
+
+   filter "configurations:Debug"
+      defines { "DEBUG", "_DEBUG" }
+      symbols "On"
+
+   filter "configurations:Release"
+      defines { "NDEBUG", "_RELEASE", "RELEASE" }
+      optimize "On"
+
+project "Benchmarks"
+   location "Benchmarks"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++20"
+   objdir ("obj/" .. outputdir .. "/%{prj.name}")
+   targetdir ("build/" .. outputdir .. "/%{prj.name}")
+
+   files
+   {
+      "%{prj.name}/**.cpp",
+      "Negroni/Core/FlightRecorder.cpp",
+      "Negroni/Core/JobSystem.cpp",
+      "Negroni/Core/Logger.cpp",
+      "Negroni/Core/Metrics.cpp"
+   }
+   includedirs { "Negroni" }
+
+   filter "system:windows"
+      buildoptions{"/utf-8"}
+      defines { "NOMINMAX" }
+
+   filter "system:linux"
+      links { "pthread" }
+
+   filter "configurations:Debug"
+      defines { "DEBUG", "_DEBUG" }
+      symbols "On"
+
+   filter "configurations:Release"
+      defines { "NDEBUG", "_RELEASE", "RELEASE" }
+      optimize "On"